@@ -3,7 +3,34 @@ SOURCES += iteratorconfigdialog.cpp \
            aboutdialog.cpp \
            hunterconfigdialog.cpp \
            lineedit.cpp \
+           logconsole.cpp \
+           urllist.cpp \
+           urlhistory.cpp \
            urlloader.cpp \
+           workqueue.cpp \
+           batchcrawler.cpp \
+           coordinator.cpp \
+           hunterprotocol.cpp \
+           hunterpool.cpp \
+           hunterresultparser.cpp \
+           webarchive.cpp \
+           requestfilter.cpp \
+           networkaccessmanager.cpp \
+           readinessmonitor.cpp \
+           pageprefetcher.cpp \
+           jsonwriter.cpp \
+           tracer.cpp \
+           memorygovernor.cpp \
+           virtualdisplay.cpp \
+           pagecapture.cpp \
+           dumppipeline.cpp \
+           filebridge.cpp \
+           processpool.cpp \
+           logger.cpp \
+           hunterresultcache.cpp \
+           dumpdelta.cpp \
+           vdombinary.cpp \
+           scriptcache.cpp \
            mainwindow.cpp \
            webview.cpp \
            webpage.cpp \
@@ -16,7 +43,34 @@ HEADERS += iterator.h \
            hunterconfigdialog.h \
            version.h \
            lineedit.h \
+           logconsole.h \
+           urllist.h \
+           urlhistory.h \
            urlloader.h \
+           workqueue.h \
+           batchcrawler.h \
+           coordinator.h \
+           hunterprotocol.h \
+           hunterpool.h \
+           hunterresultparser.h \
+           webarchive.h \
+           requestfilter.h \
+           networkaccessmanager.h \
+           readinessmonitor.h \
+           pageprefetcher.h \
+           jsonwriter.h \
+           tracer.h \
+           memorygovernor.h \
+           virtualdisplay.h \
+           pagecapture.h \
+           dumppipeline.h \
+           filebridge.h \
+           processpool.h \
+           logger.h \
+           hunterresultcache.h \
+           dumpdelta.h \
+           vdombinary.h \
+           scriptcache.h \
            mainwindow.h \
            webview.h \
            webpage.h \
@@ -27,6 +81,8 @@ CONFIG -= app_bundle
 CONFIG += qt warn_on uitools
 DESTDIR = $$PWD
 LIBS += -lQJson
+# clock_gettime() for the tracer on older glibc
+unix:LIBS += -lrt
 
 BASE_DIR = $$PWD
 QT+=xml network webkit
@@ -0,0 +1,280 @@
+#include "batchcrawler.h"
+#include "urlloader.h"
+#include "scriptcache.h"
+#include "tracer.h"
+#include "memorygovernor.h"
+#include "vdombinary.h"
+
+#include <cstdio>
+
+BatchJob::BatchJob(BatchCrawler* crawler, int id)
+    : QObject(crawler)
+    , m_crawler(crawler)
+    , m_id(id)
+    , m_pagesServed(0)
+    , m_recycle(false)
+    , m_index(-1)
+    , m_tracePage(-1)
+    , m_loadStart(0)
+{
+    createPage();
+}
+
+BatchJob::~BatchJob() {
+    destroyPage();
+}
+
+void BatchJob::createPage() {
+    m_pagesServed = 0;
+    m_page = new WebPage(0);
+    m_page->setHeadless(true);
+    m_page->setViewportSize(m_crawler->viewportSize());
+    m_page->setUserAgent("Mozilla/5.0 (Windows; U; Windows NT 5.1; zh-CN) AppleWebKit/528.16 (KHTML, like Gecko) Version/4.0 Safari/528.16");
+    m_webvdom = new QWebVDom(m_page->mainFrame());
+
+    connect(m_page->readiness(), SIGNAL(ready(bool)),
+            this, SLOT(loadFinished(bool)));
+    connect(m_page->mainFrame(), SIGNAL(javaScriptWindowObjectCleared()),
+            this, SLOT(injectEarlyJS()));
+}
+
+void BatchJob::destroyPage() {
+    delete m_webvdom;
+    m_webvdom = 0;
+    delete m_page;
+    m_page = 0;
+}
+
+void BatchJob::loadNext() {
+    if (!m_crawler->loader()->nextUrl(m_url, m_index)) {
+        m_url = QUrl();
+        m_index = -1;
+        emit idle(this);
+        return;
+    }
+    if (m_recycle) {
+        /* a fresh page gives back what the old one held on to */
+        m_recycle = false;
+        destroyPage();
+        MemoryGovernor::instance()->clearCaches();
+        createPage();
+    }
+    m_tracePage = Tracer::instance()->beginPage(QString::fromUtf8(m_url.toEncoded()));
+    m_loadStart = Tracer::isEnabled() ? Tracer::now() : 0;
+    m_page->mainFrame()->load(m_url);
+}
+
+void BatchJob::loadFinished(bool ok) {
+    if (m_index < 0) {
+        /* stray signal from a frame we no longer care about */
+        return;
+    }
+
+    const char* ready = m_page->readiness()->condition();
+    if (Tracer::isEnabled()) {
+        Tracer::instance()->span(m_tracePage, "load", m_loadStart, Tracer::now());
+        Tracer::instance()->instant(m_tracePage, ready);
+    }
+    if (!ok) {
+        m_crawler->report(m_index, m_url, "failed", ready);
+        Tracer::instance()->endPage(m_tracePage, "failed");
+    } else {
+        {
+            TraceScope scope(m_tracePage, "inject");
+            injectJS(m_crawler->injectedJSFiles());
+        }
+        /* written while the next page loads */
+        m_crawler->writeDump(dumpVdom(), m_index, m_url, ready, m_tracePage);
+        if (m_crawler->capture()) {
+            /* only painted here; encoded while the next page loads */
+            TraceScope scope(m_tracePage, "capture");
+            m_crawler->capture()->capture(m_page->mainFrame(),
+                    QString("%1/%2").arg(m_crawler->outDir()).arg(m_index));
+        }
+    }
+    m_tracePage = -1;
+
+    m_index = -1;
+    m_recycle = MemoryGovernor::instance()->pageDone(++m_pagesServed);
+    /* let WebKit unwind before we reuse (or tear down) the page */
+    QTimer::singleShot(0, this, SLOT(loadNext()));
+}
+
+void BatchJob::injectEarlyJS() {
+    injectJS(m_crawler->earlyJSFiles());
+}
+
+void BatchJob::injectJS(const QStringList& jsFiles) {
+    for (int i = 0; i < jsFiles.count(); i++) {
+        const QString& js = ScriptCache::instance()->script(jsFiles[i]);
+        if (!js.isNull()) {
+            m_page->mainFrame()->evaluateJavaScript(js + "true");
+        }
+    }
+}
+
+QByteArray BatchJob::dumpVdom() {
+    {
+        TraceScope scope(m_tracePage, "layout");
+        m_page->forceLayout();
+    }
+    TraceScope scope(m_tracePage, "dump");
+    return m_webvdom->dump();
+}
+
+BatchCrawler::BatchCrawler(const QString& listFile, int jobs, const QString& outDir)
+    : m_jobCount(jobs)
+    , m_outDir(outDir)
+    , m_dumpFormat(VdomBinary::TextDump)
+    , m_viewportSize(1024, 768)
+    , m_capture(0)
+    , m_pipeline(0)
+    , m_idleJobs(0)
+    , m_succeeded(0)
+    , m_failed(0)
+    , m_stdOut(stdout)
+{
+    m_loader = new URLLoader(listFile);
+}
+
+BatchCrawler::BatchCrawler(WorkQueue* queue, int jobs, const QString& outDir)
+    : m_loader(queue)
+    , m_jobCount(jobs)
+    , m_outDir(outDir)
+    , m_dumpFormat(VdomBinary::TextDump)
+    , m_viewportSize(1024, 768)
+    , m_capture(0)
+    , m_pipeline(0)
+    , m_idleJobs(0)
+    , m_succeeded(0)
+    , m_failed(0)
+    , m_stdOut(stdout)
+{
+}
+
+BatchCrawler::~BatchCrawler() {
+    /* the jobs go first, they may still hold leases */
+    qDeleteAll(m_jobs);
+    m_jobs.clear();
+    delete m_loader;
+}
+
+void BatchCrawler::setCaptureFormat(const QString& format) {
+    delete m_capture;
+    m_capture = 0;
+    if (format.isEmpty())
+        return;
+    m_capture = new PageCapture(this);
+    m_capture->setFormat(format);
+    connect(m_capture, SIGNAL(tileWritten(const QString&, const QString&)),
+            this, SLOT(captureTileWritten(const QString&, const QString&)));
+}
+
+bool BatchCrawler::start() {
+    if (!m_loader->isValid()) {
+        fprintf(stderr, "Failed to open the work queue: %s\n",
+                m_loader->errorString().toUtf8().data());
+        return false;
+    }
+    if (!QDir().mkpath(m_outDir)) {
+        fprintf(stderr, "Failed to create output directory %s\n",
+                m_outDir.toUtf8().data());
+        return false;
+    }
+
+    if (m_jobCount < 1)
+        m_jobCount = 1;
+
+    m_pipeline = new DumpPipeline(this);
+    connect(m_pipeline, SIGNAL(finished(int, const QByteArray&, const QByteArray&, const QString&)),
+            this, SLOT(dumpWritten(int, const QByteArray&, const QByteArray&, const QString&)));
+
+    for (int i = 0; i < m_jobCount; i++) {
+        BatchJob* job = new BatchJob(this, i);
+        connect(job, SIGNAL(idle(BatchJob*)), this, SLOT(jobIdle(BatchJob*)));
+        m_jobs.push_back(job);
+    }
+    /* kick off from the event loop so that finished() never fires
+     * before app.exec() is entered */
+    for (int i = 0; i < m_jobs.count(); i++) {
+        QTimer::singleShot(0, m_jobs[i], SLOT(loadNext()));
+    }
+    return true;
+}
+
+void BatchCrawler::report(int index, const QUrl& url, const QString& status,
+                          const char* ready) {
+    if (status == "ok") {
+        m_succeeded++;
+    } else {
+        m_failed++;
+    }
+    m_stdOut << index << "\t" << status << "\t"
+        << QString::fromUtf8(url.toEncoded());
+    if (ready) {
+        m_stdOut << "\t" << ready;
+    }
+    m_stdOut << endl;
+    m_loader->complete(index, status);
+}
+
+void BatchCrawler::writeDump(const QByteArray& vdom, int index, const QUrl& url,
+                             const char* ready, int tracePage) {
+    PendingDump dump;
+    dump.index = index;
+    dump.url = url;
+    dump.ready = ready;
+    dump.tracePage = tracePage;
+    dump.submitted = Tracer::isEnabled() ? Tracer::now() : 0;
+    QString path = QString("%1/%2.%3").arg(m_outDir).arg(index)
+        .arg(m_dumpFormat == VdomBinary::TextDump ? "vdom" : "vdb");
+    m_pendingDumps.insert(m_pipeline->submit(vdom, m_dumpFormat, path), dump);
+}
+
+void BatchCrawler::dumpWritten(int id, const QByteArray& data, const QByteArray& sha1,
+                               const QString& error) {
+    Q_UNUSED(data);
+    Q_UNUSED(sha1);
+    PendingDump dump = m_pendingDumps.take(id);
+    if (Tracer::isEnabled()) {
+        /* wall time, queueing for the writer included */
+        Tracer::instance()->span(dump.tracePage, "write", dump.submitted, Tracer::now());
+    }
+    if (error.isEmpty()) {
+        report(dump.index, dump.url, "ok", dump.ready);
+        Tracer::instance()->endPage(dump.tracePage);
+    } else {
+        report(dump.index, dump.url, error, dump.ready);
+        Tracer::instance()->endPage(dump.tracePage, "write failed");
+    }
+    if (m_idleJobs == m_jobs.count() && m_pendingDumps.isEmpty()) {
+        finish();
+    }
+}
+
+void BatchCrawler::jobIdle(BatchJob* job) {
+    Q_UNUSED(job);
+    m_idleJobs++;
+    if (m_idleJobs < m_jobs.count() || !m_pendingDumps.isEmpty())
+        return;
+    finish();
+}
+
+void BatchCrawler::finish() {
+    if (m_capture) {
+        m_capture->waitForFinished();
+    }
+    m_stdOut << "Done: " << m_succeeded << " dumped, "
+        << m_failed << " failed." << endl;
+    if (!m_loader->isValid()) {
+        fprintf(stderr, "%s\n", m_loader->errorString().toUtf8().data());
+    }
+    emit finished();
+}
+
+void BatchCrawler::captureTileWritten(const QString& path, const QString& error) {
+    Q_UNUSED(path);
+    if (!error.isEmpty()) {
+        fprintf(stderr, "%s\n", error.toUtf8().data());
+    }
+}
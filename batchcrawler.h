@@ -0,0 +1,178 @@
+#ifndef BATCHCRAWLER_H
+#define BATCHCRAWLER_H
+
+#include <qwebvdom.h> /* added to WebCore by Yahoo! China EEEE */
+#include <qwebframe.h>
+#include <QtCore>
+
+#include "webpage.h"
+#include "workqueue.h"
+#include "pagecapture.h"
+#include "dumppipeline.h"
+
+class BatchCrawler;
+
+/* One crawling slot: a headless WebPage plus its VDOM dumper. The job
+ * keeps pulling URLs from the crawler's shared queue until it runs
+ * dry. */
+class BatchJob : public QObject
+{
+    Q_OBJECT
+public:
+    BatchJob(BatchCrawler* crawler, int id);
+    ~BatchJob();
+
+    int id() const {
+        return m_id;
+    }
+
+public slots:
+    void loadNext();
+
+signals:
+    void idle(BatchJob* job);
+
+private slots:
+    void loadFinished(bool ok);
+    void injectEarlyJS();
+
+private:
+    void createPage();
+    void destroyPage();
+    void injectJS(const QStringList& jsFiles);
+    QByteArray dumpVdom();
+
+    BatchCrawler* m_crawler;
+    int m_id;
+
+    WebPage* m_page;
+    QWebVDom* m_webvdom;
+    /* pages loaded by m_page, which is rebuilt when the
+     * MemoryGovernor says so */
+    int m_pagesServed;
+    bool m_recycle;
+
+    QUrl m_url;
+    int m_index;
+
+    /* Tracer page id, -1 when not traced */
+    int m_tracePage;
+    qint64 m_loadStart;
+};
+
+/* Runs N independent BatchJobs against one URL list or work queue
+ * without any MainWindow, writing the VDOM dump of every page to the
+ * output directory as <index>.vdom (or <index>.vdb in a binary
+ * format), and optionally an image of it. */
+class BatchCrawler : public QObject
+{
+    Q_OBJECT
+public:
+    BatchCrawler(const QString& listFile, int jobs, const QString& outDir);
+    /* takes ownership of the queue */
+    BatchCrawler(WorkQueue* queue, int jobs, const QString& outDir);
+    ~BatchCrawler();
+
+    void setJSFiles(const QStringList& jsFiles) {
+        m_injectedJSFiles = jsFiles;
+    }
+
+    void setEarlyJSFiles(const QStringList& jsFiles) {
+        m_earlyJSFiles = jsFiles;
+    }
+
+    /* a VdomBinary::DumpFormat; binary dumps are named <index>.vdb */
+    void setDumpFormat(int format) {
+        m_dumpFormat = format;
+    }
+
+    int dumpFormat() const {
+        return m_dumpFormat;
+    }
+
+    /* what the pages are laid out for; there is no view to tell */
+    void setViewportSize(const QSize& size) {
+        m_viewportSize = size;
+    }
+
+    const QSize& viewportSize() const {
+        return m_viewportSize;
+    }
+
+    /* also save an image of every page dumped, "png" or "jpg", as
+     * <index>.<tile>.<format>; empty for none */
+    void setCaptureFormat(const QString& format);
+
+    /* 0 unless images are saved */
+    PageCapture* capture() const {
+        return m_capture;
+    }
+
+    bool start();
+
+    WorkQueue* loader() const {
+        return m_loader;
+    }
+
+    const QString& outDir() const {
+        return m_outDir;
+    }
+
+    const QStringList& injectedJSFiles() const {
+        return m_injectedJSFiles;
+    }
+
+    const QStringList& earlyJSFiles() const {
+        return m_earlyJSFiles;
+    }
+
+    /* ready: the readiness condition the page was dumped on */
+    void report(int index, const QUrl& url, const QString& status,
+                const char* ready = 0);
+
+    /* Hand a page's dump to the writer thread; the page is reported
+     * (and its trace ended) once the dump is written. */
+    void writeDump(const QByteArray& vdom, int index, const QUrl& url,
+                   const char* ready, int tracePage);
+
+signals:
+    void finished();
+
+private slots:
+    void jobIdle(BatchJob* job);
+    void captureTileWritten(const QString& path, const QString& error);
+    void dumpWritten(int id, const QByteArray& data, const QByteArray& sha1,
+                     const QString& error);
+
+private:
+    void finish();
+
+    struct PendingDump {
+        int index;
+        QUrl url;
+        const char* ready;
+        int tracePage;
+        qint64 submitted;
+    };
+
+    WorkQueue* m_loader;
+    int m_jobCount;
+    QString m_outDir;
+    QStringList m_injectedJSFiles;
+    QStringList m_earlyJSFiles;
+    int m_dumpFormat;
+    QSize m_viewportSize;
+    PageCapture* m_capture;
+    DumpPipeline* m_pipeline;
+    /* by DumpPipeline id */
+    QHash<int, PendingDump> m_pendingDumps;
+
+    QList<BatchJob*> m_jobs;
+    int m_idleJobs;
+
+    int m_succeeded;
+    int m_failed;
+    QTextStream m_stdOut;
+};
+
+#endif // BATCHCRAWLER_H
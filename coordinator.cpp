@@ -0,0 +1,231 @@
+#include "coordinator.h"
+#include "logger.h"
+
+#include <cstdio>
+
+const static int RESTART_DELAY = 1000;
+/* a worker dying sooner than this after start counts as a quick crash */
+const static int MIN_UPTIME = 10000;
+const static int MAX_QUICK_CRASHES = 5;
+
+QueueBroker::QueueBroker(FileWorkQueue* queue, QObject* parent)
+    : QObject(parent), m_queue(queue), m_nextId(0)
+{
+    connect(&m_server, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+}
+
+bool QueueBroker::listen(quint16 port, QString& errorString) {
+    if (!m_server.listen(QHostAddress::Any, port)) {
+        errorString = QString("Failed to listen on port %1: %2")
+            .arg(port).arg(m_server.errorString());
+        return false;
+    }
+    return true;
+}
+
+void QueueBroker::acceptConnection() {
+    while (m_server.hasPendingConnections()) {
+        QTcpSocket* socket = m_server.nextPendingConnection();
+        QString id = QString("tcp%1-%2").arg(m_nextId++)
+            .arg(socket->peerAddress().toString());
+        m_workers.insert(socket, id);
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequests()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(dropConnection()));
+        VDOM_LOG(Batch, Info, QString("broker: worker %1 connected").arg(id));
+    }
+}
+
+void QueueBroker::readRequests() {
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket || !m_workers.contains(socket)) {
+        return;
+    }
+    const QString& id = m_workers[socket];
+    while (socket->canReadLine()) {
+        QByteArray line = socket->readLine().trimmed();
+        if (line == "LEASE") {
+            QUrl url;
+            int index;
+            if (m_queue->lease(id, url, index)) {
+                socket->write("URL " + QByteArray::number(index) + ' ' +
+                        url.toEncoded() + '\n');
+            } else {
+                socket->write("DRAINED\n");
+            }
+        } else if (line.startsWith("DONE ")) {
+            int space = line.indexOf(' ', 5);
+            if (space < 0)
+                space = line.size();
+            m_queue->complete(id, line.mid(5, space - 5).toInt(),
+                    QString::fromUtf8(line.mid(space + 1)));
+        } else if (!line.isEmpty()) {
+            VDOM_LOG(Batch, Warning, QString("broker: bad request from %1: %2")
+                    .arg(id).arg(QString::fromUtf8(line)));
+            socket->disconnectFromHost();
+            return;
+        }
+    }
+}
+
+void QueueBroker::dropConnection() {
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket || !m_workers.contains(socket)) {
+        return;
+    }
+    QString id = m_workers.take(socket);
+    int requeued = m_queue->requeue(id);
+    VDOM_LOG(Batch, Info, QString("broker: worker %1 disconnected, %2 URLs requeued")
+            .arg(id).arg(requeued));
+    socket->deleteLater();
+    emit workerGone();
+}
+
+Coordinator::Coordinator(int workers, const QString& queue, const QStringList& workerArgs)
+    : m_workerCount(workers)
+    , m_queue(queue)
+    , m_workerArgs(workerArgs)
+    , m_port(0)
+    , m_fileQueue(0)
+    , m_broker(0)
+    , m_restarts(0)
+    , m_finished(false)
+{
+}
+
+Coordinator::~Coordinator() {
+    for (int i = 0; i < m_workers.count(); i++) {
+        /* do not leave orphans crawling behind */
+        disconnect(m_workers[i], 0, this, 0);
+        m_workers[i]->kill();
+        m_workers[i]->waitForFinished(5000);
+    }
+    delete m_broker;
+    delete m_fileQueue;
+}
+
+bool Coordinator::start() {
+    QString errorString;
+    if (!isRemoteQueue(m_queue)) {
+        if (!FileWorkQueue::create(m_queue, m_listFile, errorString)) {
+            fprintf(stderr, "%s\n", errorString.toUtf8().data());
+            return false;
+        }
+        m_fileQueue = new FileWorkQueue(m_queue, "coordinator");
+        if (!m_fileQueue->isValid()) {
+            fprintf(stderr, "%s\n", m_fileQueue->errorString().toUtf8().data());
+            return false;
+        }
+        if (m_port != 0) {
+            m_broker = new QueueBroker(m_fileQueue);
+            if (!m_broker->listen(m_port, errorString)) {
+                fprintf(stderr, "%s\n", errorString.toUtf8().data());
+                return false;
+            }
+            connect(m_broker, SIGNAL(workerGone()), this, SLOT(checkFinished()));
+        }
+    } else if (m_port != 0) {
+        fprintf(stderr, "Only a queue directory can be served to other hosts.\n");
+        return false;
+    }
+
+    for (int i = 0; i < m_workerCount; i++) {
+        QProcess* worker = new QProcess(this);
+        /* the workers report straight to our stdout and stderr */
+        worker->setProcessChannelMode(QProcess::ForwardedChannels);
+        connect(worker, SIGNAL(finished(int, QProcess::ExitStatus)),
+                this, SLOT(workerFinished(int, QProcess::ExitStatus)));
+        m_workers << worker;
+        m_startTimes << QTime();
+        m_quickCrashes << 0;
+    }
+    for (int i = 0; i < m_workerCount; i++) {
+        startWorker(i);
+    }
+    return true;
+}
+
+void Coordinator::startWorker(int i) {
+    QStringList args = m_workerArgs;
+    args << "--worker" << "--worker-id" << workerId(i)
+         << "--queue" << (isRemoteQueue(m_queue) ? m_queue : QFileInfo(m_queue).absoluteFilePath());
+    m_startTimes[i].start();
+    m_workers[i]->start(QCoreApplication::applicationFilePath(), args);
+}
+
+void Coordinator::workerFinished(int exitCode, QProcess::ExitStatus exitStatus) {
+    int i = m_workers.indexOf(qobject_cast<QProcess*>(sender()));
+    if (i < 0) {
+        return;
+    }
+    if (exitStatus == QProcess::NormalExit && exitCode == 0) {
+        /* the queue ran dry for it */
+        m_quickCrashes[i] = 0;
+        checkFinished();
+        return;
+    }
+
+    int requeued = m_fileQueue ? m_fileQueue->requeue(workerId(i)) : 0;
+    VDOM_LOG(Batch, Warning, QString("coordinator: worker %1 %2, %3 URLs requeued")
+            .arg(workerId(i))
+            .arg(exitStatus == QProcess::CrashExit ? QString("crashed")
+                : QString("exited with %1").arg(exitCode))
+            .arg(requeued));
+
+    if (m_startTimes[i].elapsed() < MIN_UPTIME) {
+        if (++m_quickCrashes[i] >= MAX_QUICK_CRASHES) {
+            VDOM_LOG(Batch, Error, QString("coordinator: giving up on worker %1")
+                    .arg(workerId(i)));
+            checkFinished();
+            return;
+        }
+    } else {
+        m_quickCrashes[i] = 0;
+    }
+    if (m_pendingRestarts.isEmpty()) {
+        QTimer::singleShot(RESTART_DELAY, this, SLOT(restartWorkers()));
+    }
+    m_pendingRestarts << i;
+}
+
+void Coordinator::restartWorkers() {
+    for (int i = 0; i < m_pendingRestarts.count(); i++) {
+        m_restarts++;
+        startWorker(m_pendingRestarts[i]);
+    }
+    m_pendingRestarts.clear();
+}
+
+/* Done when no worker is running or about to be restarted, remote
+ * workers included, and nothing is left in the queue. */
+void Coordinator::checkFinished() {
+    if (m_finished || !m_pendingRestarts.isEmpty()) {
+        return;
+    }
+    QList<int> drained;
+    for (int i = 0; i < m_workers.count(); i++) {
+        if (m_workers[i]->state() != QProcess::NotRunning) {
+            return;
+        }
+        if (m_quickCrashes[i] < MAX_QUICK_CRASHES) {
+            drained << i;
+        }
+    }
+    if (m_broker && m_broker->connectionCount() > 0) {
+        return;
+    }
+    if (m_fileQueue && !m_fileQueue->isFinished() && !drained.isEmpty()) {
+        /* URLs were requeued after our workers had run dry */
+        m_pendingRestarts = drained;
+        QTimer::singleShot(0, this, SLOT(restartWorkers()));
+        return;
+    }
+    m_finished = true;
+    if (m_fileQueue && !m_fileQueue->isFinished()) {
+        VDOM_LOG(Batch, Error, QString("coordinator: no workers left, stopping with "
+                "URLs still queued in %1").arg(m_queue));
+    } else {
+        VDOM_LOG(Batch, Info, QString("coordinator: done, %1 worker restarts")
+                .arg(m_restarts));
+    }
+    emit finished();
+}
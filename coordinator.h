@@ -0,0 +1,101 @@
+#ifndef COORDINATOR_H
+#define COORDINATOR_H
+
+#include <QtCore>
+#include <QtNetwork>
+
+#include "workqueue.h"
+
+/* Serves a FileWorkQueue over TCP to workers on other machines (see
+ * RemoteWorkQueue for the protocol). The leases of every connection
+ * are kept under a worker id of their own and put back when it drops. */
+class QueueBroker : public QObject {
+    Q_OBJECT
+public:
+    QueueBroker(FileWorkQueue* queue, QObject* parent = 0);
+
+    bool listen(quint16 port, QString& errorString);
+
+    int connectionCount() const {
+        return m_workers.count();
+    }
+
+signals:
+    void workerGone();
+
+private slots:
+    void acceptConnection();
+    void readRequests();
+    void dropConnection();
+
+private:
+    FileWorkQueue* m_queue;
+    QTcpServer m_server;
+    QHash<QTcpSocket*, QString> m_workers;
+    int m_nextId;
+};
+
+/* Runs N batch worker processes ("VdomBrowser --worker ...") against
+ * one work queue and keeps them running: QtWebKit is single-threaded,
+ * so processes are the way to use more than one core.
+ *
+ * The queue is either a FileWorkQueue directory, which the coordinator
+ * sets up and may also serve to other machines through a QueueBroker,
+ * or the host:port of the broker of another coordinator. A worker that
+ * crashes gets its leases requeued and is restarted after a delay; one
+ * that keeps dying right after start is given up on. */
+class Coordinator : public QObject {
+    Q_OBJECT
+public:
+    Coordinator(int workers, const QString& queue, const QStringList& workerArgs);
+    ~Coordinator();
+
+    /* the URL list to set the queue up for; none to resume it */
+    void setListFile(const QString& listFile) {
+        m_listFile = listFile;
+    }
+
+    /* serve the queue on this TCP port as well, 0 for not */
+    void setListenPort(quint16 port) {
+        m_port = port;
+    }
+
+    bool start();
+
+    static bool isRemoteQueue(const QString& queue) {
+        return queue.startsWith("tcp://");
+    }
+
+signals:
+    void finished();
+
+private slots:
+    void workerFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void restartWorkers();
+    void checkFinished();
+
+private:
+    void startWorker(int i);
+    QString workerId(int i) const {
+        return QString("w%1").arg(i);
+    }
+
+    int m_workerCount;
+    QString m_queue;
+    QStringList m_workerArgs;
+    QString m_listFile;
+    quint16 m_port;
+
+    FileWorkQueue* m_fileQueue;
+    QueueBroker* m_broker;
+
+    QList<QProcess*> m_workers;
+    QList<QTime> m_startTimes;
+    /* crashes in a row right after start */
+    QList<int> m_quickCrashes;
+    QList<int> m_pendingRestarts;
+    int m_restarts;
+    bool m_finished;
+};
+
+#endif // COORDINATOR_H
@@ -0,0 +1,136 @@
+#include "dumpdelta.h"
+
+const static char MAGIC[] = "#vdom-delta 1\n";
+
+/* no point in a delta that saves less than this much of the dump */
+const static int MAX_DELTA_PERCENT = 50;
+
+/* offsets of the line starts, plus one past the end */
+static QVector<int> lineStarts(const QByteArray& text) {
+    QVector<int> starts;
+    starts.append(0);
+    const char* data = text.constData();
+    const char* p = data;
+    const char* end = data + text.size();
+    while ((p = static_cast<const char*>(memchr(p, '\n', end - p))) != 0) {
+        starts.append(++p - data);
+    }
+    /* the last line has no '\n', pretend it has one */
+    starts.append(text.size() + 1);
+    return starts;
+}
+
+static bool sameLine(const QByteArray& a, const QVector<int>& as, int i,
+                     const QByteArray& b, const QVector<int>& bs, int j) {
+    int len = as[i + 1] - as[i];
+    return len == bs[j + 1] - bs[j] &&
+        memcmp(a.constData() + as[i], b.constData() + bs[j], len - 1) == 0;
+}
+
+QByteArray DumpDelta::make(const QByteArray& base, const QByteArray& text) {
+    QVector<int> baseStarts = lineStarts(base);
+    QVector<int> textStarts = lineStarts(text);
+    int baseLines = baseStarts.count() - 1;
+    int textLines = textStarts.count() - 1;
+
+    int first = 0;
+    while (first < baseLines && first < textLines &&
+            sameLine(base, baseStarts, first, text, textStarts, first)) {
+        first++;
+    }
+    int common = 0;
+    while (common < baseLines - first && common < textLines - first &&
+            sameLine(base, baseStarts, baseLines - 1 - common,
+                     text, textStarts, textLines - 1 - common)) {
+        common++;
+    }
+    int removed = baseLines - first - common;
+    int added = textLines - first - common;
+
+    /* the added lines with their '\n'; the last line of the dump has
+     * none of its own */
+    int from = textStarts[first];
+    int to = textStarts[first + added];
+    QByteArray lines = text.mid(from, to - from);
+    if (added > 0 && first + added == textLines) {
+        lines += '\n';
+    }
+    if (qint64(lines.size()) * 100 > qint64(text.size()) * MAX_DELTA_PERCENT) {
+        return QByteArray();
+    }
+
+    QByteArray delta(MAGIC);
+    delta += "#base ";
+    delta += QCryptographicHash::hash(base, QCryptographicHash::Sha1).toHex();
+    delta += "\n#replace ";
+    delta += QByteArray::number(first) + ' ' + QByteArray::number(removed) +
+        ' ' + QByteArray::number(added) + '\n';
+    delta += lines;
+    return delta;
+}
+
+bool DumpDelta::isDelta(const QByteArray& data) {
+    return data.startsWith(MAGIC);
+}
+
+bool DumpDelta::apply(const QByteArray& base, const QByteArray& delta,
+                      QByteArray& text, QString& errorString) {
+    if (!isDelta(delta)) {
+        errorString = "Not a VDOM delta";
+        return false;
+    }
+    int pos = sizeof(MAGIC) - 1;
+    int eol = delta.indexOf('\n', pos);
+    QByteArray line = delta.mid(pos, eol - pos);
+    if (eol < 0 || !line.startsWith("#base ")) {
+        errorString = "Missing #base line";
+        return false;
+    }
+    if (line.mid(6) != QCryptographicHash::hash(base, QCryptographicHash::Sha1).toHex()) {
+        errorString = "The delta is against a different dump";
+        return false;
+    }
+    pos = eol + 1;
+    eol = delta.indexOf('\n', pos);
+    QList<QByteArray> fields = delta.mid(pos, eol - pos).split(' ');
+    if (eol < 0 || fields.count() != 4 || fields[0] != "#replace") {
+        errorString = "Missing #replace line";
+        return false;
+    }
+    bool ok1, ok2, ok3;
+    int first = fields[1].toInt(&ok1);
+    int removed = fields[2].toInt(&ok2);
+    int added = fields[3].toInt(&ok3);
+    QVector<int> baseStarts = lineStarts(base);
+    int baseLines = baseStarts.count() - 1;
+    if (!ok1 || !ok2 || !ok3 || first < 0 || removed < 0 || added < 0 ||
+            first + removed > baseLines) {
+        errorString = "Bad #replace line";
+        return false;
+    }
+    pos = eol + 1;
+    QByteArray lines = delta.mid(pos);
+    if (lines.count('\n') != added) {
+        errorString = QString("Expected %1 added lines").arg(added);
+        return false;
+    }
+
+    /* everything as joined by '\n'; line starts are one past a '\n' */
+    QByteArray head = base.left(baseStarts[first]);
+    if (first == baseLines) {
+        /* appending to the last line of the base */
+        head += '\n';
+    }
+    QByteArray tail;
+    if (first + removed < baseLines) {
+        tail = base.mid(baseStarts[first + removed]);
+    } else {
+        /* nothing follows, so the last added line has no '\n' */
+        lines.chop(1);
+        if (added == 0) {
+            head.chop(1);
+        }
+    }
+    text = head + lines + tail;
+    return true;
+}
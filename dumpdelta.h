@@ -0,0 +1,36 @@
+#ifndef DUMP_DELTA_H
+#define DUMP_DELTA_H
+
+#include <QtCore>
+
+/* A line-level delta between two text VDOM dumps, for re-hunting a
+ * page whose previous dump the hunter still has on disk.
+ *
+ * The changed lines of a page usually sit together (a widget that
+ * re-rendered, a list that grew), so the delta is a single hunk: the
+ * lines both dumps start and end with are kept and the ones between
+ * them replaced.
+ *
+ *   #vdom-delta 1
+ *   #base <sha1 of the base dump, hex>
+ *   #replace <first line> <lines removed> <lines added>
+ *   <the added lines, each terminated by \n>
+ *
+ * Lines are what splitting the dump on '\n' gives (so a dump ending
+ * in '\n' has an empty last line) and are counted from 0. A hunter
+ * rebuilds the new dump as base lines [0, first), the added lines and
+ * base lines [first + removed, end), joined by '\n';
+ * hunter/VdomDump.pm does that for Perl hunters. */
+class DumpDelta {
+public:
+    /* The delta from base to text, or a null QByteArray when it would
+     * not be much smaller than text itself. */
+    static QByteArray make(const QByteArray& base, const QByteArray& text);
+
+    static bool isDelta(const QByteArray& data);
+
+    static bool apply(const QByteArray& base, const QByteArray& delta,
+                      QByteArray& text, QString& errorString);
+};
+
+#endif // DUMP_DELTA_H
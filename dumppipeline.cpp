@@ -0,0 +1,65 @@
+#include "dumppipeline.h"
+#include "vdombinary.h"
+
+DumpPipeline::DumpPipeline(QObject* parent)
+    : QObject(parent)
+    , m_nextId(0)
+    , m_pending(0)
+{
+    DumpStage* stage = new DumpStage;
+    stage->moveToThread(&m_thread);
+    connect(stage, SIGNAL(done(int, const QByteArray&, const QByteArray&, const QString&)),
+            this, SLOT(stageDone(int, const QByteArray&, const QByteArray&, const QString&)));
+    m_stage = stage;
+    m_thread.start();
+}
+
+DumpPipeline::~DumpPipeline() {
+    /* dumps still queued are dropped */
+    m_thread.quit();
+    m_thread.wait();
+    delete m_stage;
+}
+
+int DumpPipeline::submit(const QByteArray& text, int format, const QString& path,
+                         bool hash, const QByteArray& hashed) {
+    int id = m_nextId++;
+    m_pending++;
+    QMetaObject::invokeMethod(m_stage, "process", Qt::QueuedConnection,
+            Q_ARG(int, id), Q_ARG(QByteArray, text), Q_ARG(int, format),
+            Q_ARG(QString, path), Q_ARG(bool, hash), Q_ARG(QByteArray, hashed));
+    return id;
+}
+
+void DumpPipeline::stageDone(int id, const QByteArray& data, const QByteArray& sha1,
+                             const QString& error) {
+    m_pending--;
+    emit finished(id, data, sha1, error);
+}
+
+void DumpStage::process(int id, const QByteArray& text, int format, const QString& path,
+                        bool hash, const QByteArray& hashed) {
+    QByteArray data = format == VdomBinary::TextDump
+        ? text : VdomBinary::encode(text, format);
+    QString error;
+    if (!path.isEmpty()) {
+        QFile file(path);
+        QIODevice::OpenMode mode = QIODevice::WriteOnly;
+        if (format == VdomBinary::TextDump)
+            mode |= QIODevice::Text;
+        if (!file.open(mode)) {
+            error = QString("failed to open %1 for writing: %2")
+                .arg(path).arg(file.errorString());
+        } else if (file.write(data) == -1) {
+            error = QString("failed to write %1: %2")
+                .arg(path).arg(file.errorString());
+        }
+        file.close();
+    }
+    QByteArray sha1;
+    if (hash) {
+        sha1 = QCryptographicHash::hash(hashed.isNull() ? text : hashed,
+                                        QCryptographicHash::Sha1);
+    }
+    emit done(id, data, sha1, error);
+}
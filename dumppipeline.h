@@ -0,0 +1,61 @@
+#ifndef DUMP_PIPELINE_H
+#define DUMP_PIPELINE_H
+
+#include <QtCore>
+
+/* The stages of a dump that need no WebKit: encoding it, writing it
+ * out and hashing it, on a writer thread of their own.
+ *
+ * submit() only takes a reference to the dump (QByteArray is shared
+ * implicitly), so the GUI thread can go on with the next page as soon
+ * as the dump is taken. Dumps are handled strictly in the order
+ * submitted, so two dumps for one path land in that order. finished()
+ * comes back on the thread that owns the pipeline; errors are passed
+ * along there instead of being reported by the writer. */
+class DumpPipeline : public QObject {
+    Q_OBJECT
+public:
+    DumpPipeline(QObject* parent = 0);
+    ~DumpPipeline();
+
+    /* Encode text in a VdomBinary::DumpFormat and write it to path
+     * (skipped if empty). With hash, the SHA-1 is taken of hashed, if
+     * given, or else of text. Returns the id finished() will carry. */
+    int submit(const QByteArray& text, int format, const QString& path,
+               bool hash = false, const QByteArray& hashed = QByteArray());
+
+    /* dumps submitted but not finished */
+    int pending() const {
+        return m_pending;
+    }
+
+signals:
+    /* data: the dump as encoded, sha1: of the text hashed, empty
+     * unless asked for, error: empty on success */
+    void finished(int id, const QByteArray& data, const QByteArray& sha1,
+                  const QString& error);
+
+private slots:
+    void stageDone(int id, const QByteArray& data, const QByteArray& sha1,
+                   const QString& error);
+
+private:
+    QThread m_thread;
+    QObject* m_stage;
+    int m_nextId;
+    int m_pending;
+};
+
+/* The writer thread side of a DumpPipeline. */
+class DumpStage : public QObject {
+    Q_OBJECT
+public slots:
+    void process(int id, const QByteArray& text, int format, const QString& path,
+                 bool hash, const QByteArray& hashed);
+
+signals:
+    void done(int id, const QByteArray& data, const QByteArray& sha1,
+              const QString& error);
+};
+
+#endif // DUMP_PIPELINE_H
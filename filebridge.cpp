@@ -0,0 +1,215 @@
+#include "filebridge.h"
+
+#include <qwebframe.h>
+
+/* The page-side half of the bridge; see filebridge.h. */
+const static char FILE_LIB[] =
+    "window.vdom_fs = (function (bridge) {"
+      "var pending = {};"
+      "bridge.completed.connect(function (id, result) {"
+        "var cb = pending[id];"
+        "if (!cb) return;"
+        "delete pending[id];"
+        "cb(result.error || null, result);"
+      "});"
+      "function call(id, cb) { if (cb) pending[id] = cb; }"
+      "function opt(v, def) { return v == null ? def : v; }"
+      "function write(path, data, opts, cb, append) {"
+        "if (typeof opts == 'function') { cb = opts; opts = {}; }"
+        "opts = opts || {};"
+        "call(bridge.write(path, String(data), opt(opts.encoding, 'utf8'), append), cb);"
+      "}"
+      "return {"
+        "stat: function (path, cb) { call(bridge.stat(path), cb); },"
+        "read: function (path, opts, cb) {"
+          "if (typeof opts == 'function') { cb = opts; opts = {}; }"
+          "opts = opts || {};"
+          "call(bridge.read(path, opt(opts.offset, 0), opt(opts.length, -1),"
+                           "opt(opts.encoding, 'utf8')), cb);"
+        "},"
+        "write: function (path, data, opts, cb) { write(path, data, opts, cb, false); },"
+        "append: function (path, data, opts, cb) { write(path, data, opts, cb, true); },"
+        "readChunks: function (path, opts, onChunk, onDone) {"
+          "opts = opts || {};"
+          "var offset = opt(opts.offset, 0), size = opt(opts.chunkSize, 65536),"
+              "encoding = opt(opts.encoding, 'utf8');"
+          "onDone = onDone || function () {};"
+          "function next() {"
+            "call(bridge.read(path, offset, size, encoding), function (err, res) {"
+              "if (err) return onDone(err);"
+              "if (res.data.length && onChunk(res.data, offset) === false)"
+                "return onDone(null);"
+              "offset = res.next;"
+              "if (res.eof) onDone(null); else next();"
+            "});"
+          "}"
+          "next();"
+        "}"
+      "};"
+    "})(window.vdom_files);";
+
+static QVariantMap failure(const QString& error) {
+    QVariantMap result;
+    result["error"] = error;
+    return result;
+}
+
+static bool encode(const QByteArray& bytes, const QString& encoding, QString& data) {
+    if (encoding == "utf8") {
+        data = QString::fromUtf8(bytes.constData(), bytes.size());
+    } else if (encoding == "base64") {
+        data = QString::fromLatin1(bytes.toBase64());
+    } else if (encoding == "binary") {
+        data = QString::fromLatin1(bytes.constData(), bytes.size());
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool decode(const QString& data, const QString& encoding, QByteArray& bytes) {
+    if (encoding == "utf8") {
+        bytes = data.toUtf8();
+    } else if (encoding == "base64") {
+        bytes = QByteArray::fromBase64(data.toLatin1());
+    } else if (encoding == "binary") {
+        bytes = data.toLatin1();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/* the length of bytes without a UTF-8 sequence cut off at the end */
+static int utf8Boundary(const QByteArray& bytes) {
+    int size = bytes.size();
+    for (int i = size - 1; i >= 0 && i >= size - 4; i--) {
+        uchar c = bytes.at(i);
+        if ((c & 0xc0) == 0x80)
+            continue;
+        int needed = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+        return size - i < needed ? i : size;
+    }
+    return size;
+}
+
+FileBridge::FileBridge(QObject* parent)
+    : QObject(parent)
+    , m_nextId(0)
+{
+    FileBridgeWorker* worker = new FileBridgeWorker;
+    worker->moveToThread(&m_thread);
+    connect(worker, SIGNAL(done(int, const QVariantMap&)),
+            this, SIGNAL(completed(int, const QVariantMap&)));
+    m_worker = worker;
+    m_thread.start();
+}
+
+FileBridge::~FileBridge() {
+    m_thread.quit();
+    m_thread.wait();
+    delete m_worker;
+}
+
+void FileBridge::install(QWebFrame* frame) {
+    frame->addToJavaScriptWindowObject("vdom_files", this);
+    frame->evaluateJavaScript(QString::fromLatin1(FILE_LIB) + "true");
+}
+
+int FileBridge::stat(const QString& path) {
+    int id = m_nextId++;
+    QMetaObject::invokeMethod(m_worker, "stat", Qt::QueuedConnection,
+            Q_ARG(int, id), Q_ARG(QString, path));
+    return id;
+}
+
+int FileBridge::read(const QString& path, double offset, int length,
+                     const QString& encoding) {
+    int id = m_nextId++;
+    QMetaObject::invokeMethod(m_worker, "read", Qt::QueuedConnection,
+            Q_ARG(int, id), Q_ARG(QString, path), Q_ARG(double, offset),
+            Q_ARG(int, length), Q_ARG(QString, encoding));
+    return id;
+}
+
+int FileBridge::write(const QString& path, const QString& data,
+                      const QString& encoding, bool append) {
+    int id = m_nextId++;
+    QMetaObject::invokeMethod(m_worker, "write", Qt::QueuedConnection,
+            Q_ARG(int, id), Q_ARG(QString, path), Q_ARG(QString, data),
+            Q_ARG(QString, encoding), Q_ARG(bool, append));
+    return id;
+}
+
+void FileBridgeWorker::stat(int id, const QString& path) {
+    QFileInfo info(path);
+    QVariantMap result;
+    result["exists"] = info.exists();
+    result["size"] = double(info.size());
+    result["isDir"] = info.isDir();
+    result["modified"] = info.lastModified();
+    emit done(id, result);
+}
+
+void FileBridgeWorker::read(int id, const QString& path, double offset, int length,
+                            const QString& encoding) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit done(id, failure(QString("failed to open %1: %2")
+                .arg(path).arg(file.errorString())));
+        return;
+    }
+    qint64 size = file.size();
+    qint64 pos = qint64(offset);
+    if (pos < 0 || !file.seek(pos)) {
+        emit done(id, failure(QString("failed to seek to %1 in %2")
+                .arg(pos).arg(path)));
+        return;
+    }
+    QByteArray bytes = length < 0 ? file.readAll() : file.read(length);
+    if (encoding == "utf8" && pos + bytes.size() < size) {
+        /* leave a character cut in two to the next chunk */
+        int boundary = utf8Boundary(bytes);
+        if (boundary > 0)
+            bytes.truncate(boundary);
+    }
+    QString data;
+    if (!encode(bytes, encoding, data)) {
+        emit done(id, failure(QString("unknown encoding %1").arg(encoding)));
+        return;
+    }
+    QVariantMap result;
+    result["data"] = data;
+    result["offset"] = double(pos);
+    result["next"] = double(pos + bytes.size());
+    result["eof"] = pos + bytes.size() >= size;
+    result["size"] = double(size);
+    emit done(id, result);
+}
+
+void FileBridgeWorker::write(int id, const QString& path, const QString& data,
+                             const QString& encoding, bool append) {
+    QByteArray bytes;
+    if (!decode(data, encoding, bytes)) {
+        emit done(id, failure(QString("unknown encoding %1").arg(encoding)));
+        return;
+    }
+    QFile file(path);
+    QIODevice::OpenMode mode = QIODevice::WriteOnly;
+    mode |= append ? QIODevice::Append : QIODevice::Truncate;
+    if (!file.open(mode)) {
+        emit done(id, failure(QString("failed to open %1 for writing: %2")
+                .arg(path).arg(file.errorString())));
+        return;
+    }
+    if (file.write(bytes) != bytes.size()) {
+        emit done(id, failure(QString("failed to write %1: %2")
+                .arg(path).arg(file.errorString())));
+        return;
+    }
+    file.close();
+    QVariantMap result;
+    result["written"] = bytes.size();
+    result["size"] = double(QFileInfo(path).size());
+    emit done(id, result);
+}
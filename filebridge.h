@@ -0,0 +1,68 @@
+#ifndef FILE_BRIDGE_H
+#define FILE_BRIDGE_H
+
+#include <QtCore>
+
+class QWebFrame;
+
+/* Asynchronous file access for the scripts of a page.
+ *
+ * install() adds the bridge to a frame as window.vdom_files together
+ * with a small library, window.vdom_fs, which wraps it in callbacks:
+ *
+ *   vdom_fs.stat(path, cb)
+ *   vdom_fs.read(path, {offset, length, encoding}, cb)
+ *   vdom_fs.write(path, data, {encoding}, cb)
+ *   vdom_fs.append(path, data, {encoding}, cb)
+ *   vdom_fs.readChunks(path, {offset, chunkSize, encoding},
+ *                      onChunk(data, offset), onDone(err))
+ *
+ * Callbacks are called as cb(err, result) with err null on success.
+ * Data is passed as a string in one of three encodings: "utf8" (the
+ * default; chunks never split a character), "base64" or "binary" (one
+ * character per byte). The I/O runs on a thread of its own, one
+ * request at a time in the order made, so a run of appends lands in
+ * order without waiting for each one. */
+class FileBridge : public QObject {
+    Q_OBJECT
+public:
+    FileBridge(QObject* parent = 0);
+    ~FileBridge();
+
+    /* expose the bridge to the scripts of frame */
+    void install(QWebFrame* frame);
+
+public slots:
+    /* each returns the id the result will carry in completed();
+     * length -1 reads to the end of the file */
+    int stat(const QString& path);
+    int read(const QString& path, double offset, int length,
+             const QString& encoding);
+    int write(const QString& path, const QString& data,
+              const QString& encoding, bool append);
+
+signals:
+    /* result has "error" set on failure */
+    void completed(int id, const QVariantMap& result);
+
+private:
+    QThread m_thread;
+    QObject* m_worker;
+    int m_nextId;
+};
+
+/* The I/O thread side of a FileBridge. */
+class FileBridgeWorker : public QObject {
+    Q_OBJECT
+public slots:
+    void stat(int id, const QString& path);
+    void read(int id, const QString& path, double offset, int length,
+              const QString& encoding);
+    void write(int id, const QString& path, const QString& data,
+               const QString& encoding, bool append);
+
+signals:
+    void done(int id, const QVariantMap& result);
+};
+
+#endif // FILE_BRIDGE_H
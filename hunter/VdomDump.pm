@@ -0,0 +1,188 @@
+package VdomDump;
+
+# Reading what VdomBrowser hands to a hunter back into the text VDOM
+# dump, whatever form it came in:
+#
+#   * text dumps, as they are;
+#   * binary "VDB" dumps (--dump-format binary|binary-z, see
+#     vdombinary.h);
+#   * line deltas against the dump file the hunter already has
+#     (--delta, see dumpdelta.h), themselves text or VDB;
+#   * dumps framed on stdin (the pipe and pool transports, see
+#     hunterprotocol.h).
+#
+# A hunter that takes its arguments the way VdomBrowser passes them
+# needs just
+#
+#   use VdomDump;
+#   my $vdom = VdomDump::read_input(@ARGV);
+#
+# Everything croaks on malformed input.
+
+use strict;
+use warnings;
+
+use Carp qw(croak);
+use Compress::Zlib ();
+use Digest::SHA ();
+
+our $VERSION = '0.01';
+
+my $VDB_MAGIC = 'VDB1';
+my $VDB_HEADER_SIZE = 8;
+my $DELTA_MAGIC = "#vdom-delta 1\n";
+
+# The text dump for the hunter's arguments: "-" for a frame on stdin,
+# "<dump>" for a dump file or "<dump> --delta <delta>" for a delta
+# against the dump file.
+sub read_input {
+    my ($path, @rest) = @_;
+    croak "No dump given" unless defined $path;
+    if ($path eq '-') {
+        return decode(read_frame(\*STDIN));
+    }
+    my $text = decode(slurp($path));
+    if (@rest >= 2 && $rest[0] eq '--delta') {
+        $text = apply_delta($text, decode(slurp($rest[1])));
+    }
+    return $text;
+}
+
+sub slurp {
+    my ($path) = @_;
+    open my $in, '<', $path or croak "Cannot open $path: $!";
+    binmode $in;
+    local $/;
+    my $data = <$in>;
+    close $in;
+    return defined $data ? $data : '';
+}
+
+# One "<length>\n<payload>" frame.
+sub read_frame {
+    my ($fh) = @_;
+    binmode $fh;
+    my $len = <$fh>;
+    croak "No frame" unless defined $len;
+    chomp $len;
+    croak "Bad frame length: $len" unless $len =~ /^\d+$/;
+    my $buf = '';
+    while (length $buf < $len) {
+        my $n = read($fh, $buf, $len - length $buf, length $buf);
+        croak "Read failed: $!" unless defined $n;
+        croak "Truncated frame" if $n == 0;
+    }
+    return $buf;
+}
+
+sub is_binary {
+    my ($data) = @_;
+    return length $data >= $VDB_HEADER_SIZE
+        && substr($data, 0, 4) eq $VDB_MAGIC;
+}
+
+# A VDB dump to the text dump; anything else is a text dump already.
+sub decode {
+    my ($data) = @_;
+    return $data unless is_binary($data);
+
+    my $records;
+    if (ord(substr($data, 4, 1)) & 0x01) {
+        $records = '';
+        my $pos = $VDB_HEADER_SIZE;
+        my $end = length $data;
+        while ($pos < $end) {
+            croak "Corrupt compressed chunk" if $pos + 4 > $end;
+            my $len = unpack 'N', substr($data, $pos, 4);
+            $pos += 4;
+            croak "Corrupt compressed chunk" if $len < 4 || $pos + $len > $end;
+            # qCompress(): the size as a big-endian u32, then zlib
+            my $chunk = Compress::Zlib::uncompress(substr($data, $pos + 4, $len - 4));
+            croak "Corrupt compressed chunk" unless defined $chunk;
+            $records .= $chunk;
+            $pos += $len;
+        }
+    } else {
+        $records = substr($data, $VDB_HEADER_SIZE);
+    }
+
+    my @table;
+    my $text = '';
+    my $pos = 0;
+    my $end = length $records;
+    while ($pos < $end) {
+        my $op = ord substr($records, $pos++, 1);
+        if ($op == 0x01 || $op == 0x05) {
+            my $len = _varint(\$records, \$pos);
+            croak "Truncated string" if $pos + $len > $end;
+            my $str = substr($records, $pos, $len);
+            $pos += $len;
+            push @table, $str if $op == 0x01;
+            $text .= $str;
+        } elsif ($op == 0x02) {
+            my $index = _varint(\$records, \$pos);
+            croak "String $index not defined" if $index >= @table;
+            $text .= $table[$index];
+        } elsif ($op == 0x03) {
+            croak "Truncated integer" if $pos + 4 > $end;
+            my $value = unpack 'V', substr($records, $pos, 4);
+            $pos += 4;
+            $value -= 4294967296 if $value >= 2147483648;
+            $text .= $value;
+        } elsif ($op == 0x04) {
+            $text .= "\n";
+        } else {
+            croak sprintf "Unknown opcode 0x%02x", $op;
+        }
+    }
+    return $text;
+}
+
+sub _varint {
+    my ($data, $pos) = @_;
+    my $value = 0;
+    for (my $shift = 0; $shift < 35; $shift += 7) {
+        croak "Truncated varint" if $$pos >= length $$data;
+        my $c = ord substr($$data, $$pos++, 1);
+        $value |= ($c & 0x7f) << $shift;
+        return $value unless $c & 0x80;
+    }
+    croak "Bad varint";
+}
+
+sub is_delta {
+    my ($data) = @_;
+    return substr($data, 0, length $DELTA_MAGIC) eq $DELTA_MAGIC;
+}
+
+# The dump a delta made against $base describes.
+sub apply_delta {
+    my ($base, $delta) = @_;
+    croak "Not a VDOM delta" unless is_delta($delta);
+    my $rest = substr($delta, length $DELTA_MAGIC);
+
+    $rest =~ s/^#base ([0-9a-f]{40})\n// or croak "Missing #base line";
+    croak "The delta is against a different dump"
+        if $1 ne Digest::SHA::sha1_hex($base);
+    $rest =~ s/^#replace (\d+) (\d+) (\d+)\n// or croak "Missing #replace line";
+    my ($first, $removed, $added) = ($1, $2, $3);
+
+    my @lines = _lines($base);
+    croak "Bad #replace line" if $first + $removed > @lines;
+    croak "Expected $added added lines" if ($rest =~ tr/\n//) != $added;
+    # every added line comes with its "\n"
+    my @new = split /\n/, $rest, -1;
+    pop @new;
+
+    splice @lines, $first, $removed, @new;
+    return join "\n", @lines;
+}
+
+# what splitting on "\n" gives, an empty last line included
+sub _lines {
+    my ($text) = @_;
+    return ('') if $text eq '';
+    return split /\n/, $text, -1;
+}
+
+1;
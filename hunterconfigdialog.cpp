@@ -1,4 +1,5 @@
 #include "hunterconfigdialog.h"
+#include "vdombinary.h"
 //#include <QDebug>
 
 HunterConfigDialog::HunterConfigDialog(QWidget *parent): QDialog(parent) {
@@ -42,6 +43,82 @@ HunterConfigDialog::HunterConfigDialog(QWidget *parent): QDialog(parent) {
             this, SLOT(browseVdomFile()));
     formLayout->addWidget(button, 1, 2);
 
+    label = new QLabel(tr("&Transport"), this);
+    formLayout->addWidget(label, 2, 0);
+
+    transportCombo = new QComboBox(this);
+    transportCombo->addItem(tr("Temporary files"), QVariant(FileTransport));
+    transportCombo->addItem(tr("Pipes (framed stdin/stdout)"), QVariant(PipeTransport));
+    transportCombo->addItem(tr("Persistent worker pool"), QVariant(PoolTransport));
+    formLayout->addWidget(transportCombo, 2, 1);
+    label->setBuddy(transportCombo);
+
+    label = new QLabel(tr("Dump &format"), this);
+    formLayout->addWidget(label, 3, 0);
+
+    dumpFormatCombo = new QComboBox(this);
+    dumpFormatCombo->addItem(tr("Text"), QVariant(VdomBinary::TextDump));
+    dumpFormatCombo->addItem(tr("Binary (interned strings)"),
+                             QVariant(VdomBinary::BinaryDump));
+    dumpFormatCombo->addItem(tr("Binary, compressed"),
+                             QVariant(VdomBinary::CompressedBinaryDump));
+    formLayout->addWidget(dumpFormatCombo, 3, 1);
+    label->setBuddy(dumpFormatCombo);
+
+    label = new QLabel(tr("&Pool workers"), this);
+    formLayout->addWidget(label, 4, 0);
+
+    poolSizeSpin = new QSpinBox(this);
+    poolSizeSpin->setRange(1, 64);
+    poolSizeSpin->setValue(2);
+    formLayout->addWidget(poolSizeSpin, 4, 1);
+    label->setBuddy(poolSizeSpin);
+
+    label = new QLabel(tr("Per-page &deadline"), this);
+    formLayout->addWidget(label, 5, 0);
+
+    deadlineSpin = new QSpinBox(this);
+    deadlineSpin->setRange(0, 3600);
+    deadlineSpin->setValue(30);
+    deadlineSpin->setSuffix(tr(" s"));
+    deadlineSpin->setSpecialValueText(tr("None"));
+    formLayout->addWidget(deadlineSpin, 5, 1);
+    label->setBuddy(deadlineSpin);
+
+    label = new QLabel(tr("Worker &memory limit"), this);
+    formLayout->addWidget(label, 6, 0);
+
+    memoryLimitSpin = new QSpinBox(this);
+    memoryLimitSpin->setRange(0, 65536);
+    memoryLimitSpin->setValue(1024);
+    memoryLimitSpin->setSuffix(tr(" MB"));
+    memoryLimitSpin->setSpecialValueText(tr("Unlimited"));
+    formLayout->addWidget(memoryLimitSpin, 6, 1);
+    label->setBuddy(memoryLimitSpin);
+
+    label = new QLabel(tr("Log &lines kept"), this);
+    formLayout->addWidget(label, 7, 0);
+
+    logLinesSpin = new QSpinBox(this);
+    logLinesSpin->setRange(100, 1000000);
+    logLinesSpin->setSingleStep(100);
+    logLinesSpin->setValue(1000);
+    formLayout->addWidget(logLinesSpin, 7, 1);
+    label->setBuddy(logLinesSpin);
+
+    label = new QLabel(tr("Per-page log &directory"), this);
+    formLayout->addWidget(label, 8, 0);
+
+    logDirEdit = new QLineEdit(this);
+    logDirEdit->setCompleter(completer);
+    formLayout->addWidget(logDirEdit, 8, 1);
+    label->setBuddy(logDirEdit);
+
+    button = new QPushButton(tr("Browse..."), this);
+    connect(button, SIGNAL(clicked()),
+            this, SLOT(browseLogDir()));
+    formLayout->addWidget(button, 8, 2);
+
     formLayout->setSpacing(20);
 
     layout->addWidget(formGroup);
@@ -64,7 +141,7 @@ HunterConfigDialog::HunterConfigDialog(QWidget *parent): QDialog(parent) {
     //layout->addStretch();
 
     setLayout(layout);
-    setFixedSize(QSize(700, 200));
+    setFixedSize(QSize(700, 490));
     setWindowTitle(tr("X Hunter Configuration"));
 }
 
@@ -90,12 +167,12 @@ void HunterConfigDialog::accept() {
         }
 
         QString vdomPath = vdomPathEdit->text().trimmed();
-        if (vdomPath.isEmpty()) {
+        if (vdomPath.isEmpty() && transport() == FileTransport) {
             croak(tr("VDOM Output File Path is empty."));
             vdomPathEdit->selectAll();
             return;
         }
-        if (QFile::exists(vdomPath)) {
+        if (!vdomPath.isEmpty() && QFile::exists(vdomPath)) {
             //qDebug() << "VDOM Path " << vdomPath << " exists.\n";
             perms = QFile::permissions(vdomPath);
             if (! (perms & QFile::WriteUser)) {
@@ -105,6 +182,13 @@ void HunterConfigDialog::accept() {
             }
             //qDebug() << "VDOM Path " << vdomPath << " is writable.\n";
         }
+
+        QString logDir = logDirEdit->text().trimmed();
+        if (!logDir.isEmpty() && !QFileInfo(logDir).isDir()) {
+            croak(tr("Log directory \"%1\" does not exist.").arg(logDir));
+            logDirEdit->selectAll();
+            return;
+        }
     }
     QDialog::accept();
 }
@@ -121,9 +205,16 @@ void HunterConfigDialog::browseProgFile() {
 void HunterConfigDialog::browseVdomFile() {
      const QString& fileName = QFileDialog::getSaveFileName(
          this, tr("VDOM Output File"),
-         0, tr("Text Files (*.txt *.dom *.vdom)"));
+         0, tr("VDOM Files (*.txt *.dom *.vdom *.vdb);;Any Files (*)"));
      if (!fileName.isEmpty()) {
          vdomPathEdit->setText(fileName);
      }
 }
 
+void HunterConfigDialog::browseLogDir() {
+     const QString& dir = QFileDialog::getExistingDirectory(
+         this, tr("Per-page Log Directory"));
+     if (!dir.isEmpty()) {
+         logDirEdit->setText(dir);
+     }
+}
@@ -9,6 +9,13 @@ class HunterConfigDialog: public QDialog {
     Q_OBJECT
 
 public:
+    /* how the VDOM dump and the hunter result travel */
+    enum Transport {
+        FileTransport = 0,  /* dump file + <dump>.res file on disk */
+        PipeTransport = 1,  /* framed dump on stdin, framed result on stdout */
+        PoolTransport = 2   /* pipes to long-lived "hunter --server" workers */
+    };
+
     HunterConfigDialog(QWidget *parent = 0);
 
     void setHunterEnabled(bool enabled) {
@@ -23,6 +30,36 @@ public:
         vdomPathEdit->setText(path.trimmed());
     }
 
+    void setTransport(int transport) {
+        int i = transportCombo->findData(transport);
+        transportCombo->setCurrentIndex(i < 0 ? 0 : i);
+    }
+
+    void setDumpFormat(int format) {
+        int i = dumpFormatCombo->findData(format);
+        dumpFormatCombo->setCurrentIndex(i < 0 ? 0 : i);
+    }
+
+    void setPoolSize(int size) {
+        poolSizeSpin->setValue(size);
+    }
+
+    void setDeadline(int secs) {
+        deadlineSpin->setValue(secs);
+    }
+
+    void setMemoryLimit(int mb) {
+        memoryLimitSpin->setValue(mb);
+    }
+
+    void setLogLines(int lines) {
+        logLinesSpin->setValue(lines);
+    }
+
+    void setLogDir(const QString& dir) {
+        logDirEdit->setText(dir.trimmed());
+    }
+
     bool hunterEnabled() {
         return formGroup->isChecked();
     }
@@ -35,10 +72,40 @@ public:
         return vdomPathEdit->text().trimmed();
     }
 
+    int transport() const {
+        return transportCombo->itemData(transportCombo->currentIndex()).toInt();
+    }
+
+    /* a VdomBinary::DumpFormat */
+    int dumpFormat() const {
+        return dumpFormatCombo->itemData(dumpFormatCombo->currentIndex()).toInt();
+    }
+
+    int poolSize() const {
+        return poolSizeSpin->value();
+    }
+
+    int deadline() const {
+        return deadlineSpin->value();
+    }
+
+    int memoryLimit() const {
+        return memoryLimitSpin->value();
+    }
+
+    int logLines() const {
+        return logLinesSpin->value();
+    }
+
+    QString logDir() const {
+        return logDirEdit->text().trimmed();
+    }
+
 public slots:
     virtual void accept();
     void browseProgFile();
     void browseVdomFile();
+    void browseLogDir();
 
 private:
     void croak(const QString& msg) {
@@ -47,6 +114,13 @@ private:
     }
     QLineEdit* progPathEdit;
     QLineEdit* vdomPathEdit;
+    QComboBox* transportCombo;
+    QComboBox* dumpFormatCombo;
+    QSpinBox* poolSizeSpin;
+    QSpinBox* deadlineSpin;
+    QSpinBox* memoryLimitSpin;
+    QSpinBox* logLinesSpin;
+    QLineEdit* logDirEdit;
     QGroupBox* formGroup;
 };
 
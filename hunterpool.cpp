@@ -0,0 +1,231 @@
+#include "hunterpool.h"
+
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+/* delay before replacing a dead worker, so that a hunter which dies
+ * right on startup does not make us spin */
+const static int RESPAWN_DELAY = 500;
+
+void HunterProcess::setupChildProcess() {
+    /* runs in the child between fork() and exec(): keep it to plain
+     * syscalls */
+    if (m_memoryLimit > 0) {
+        struct rlimit rl;
+        rl.rlim_cur = rl.rlim_max = (rlim_t) m_memoryLimit * 1024 * 1024;
+        setrlimit(RLIMIT_AS, &rl);
+    }
+    struct rlimit core;
+    core.rlim_cur = core.rlim_max = 0;
+    setrlimit(RLIMIT_CORE, &core);
+    if (m_niceness > 0) {
+        setpriority(PRIO_PROCESS, 0, m_niceness);
+    }
+}
+
+HunterWorker::HunterWorker(QObject* parent)
+    : QObject(parent), m_jobId(-1), m_dead(false)
+{
+    m_proc = new HunterProcess(this);
+    m_proc->setNiceness(5);
+    connect(m_proc, SIGNAL(readyReadStandardOutput()),
+            this, SLOT(readStdout()));
+    connect(m_proc, SIGNAL(readyReadStandardError()),
+            this, SLOT(readStderr()));
+    connect(m_proc, SIGNAL(finished(int, QProcess::ExitStatus)),
+            this, SLOT(processFinished(int, QProcess::ExitStatus)));
+    connect(m_proc, SIGNAL(error(QProcess::ProcessError)),
+            this, SLOT(processError(QProcess::ProcessError)));
+
+    m_deadline.setSingleShot(true);
+    connect(&m_deadline, SIGNAL(timeout()), this, SLOT(deadlineExceeded()));
+}
+
+HunterWorker::~HunterWorker() {
+    m_proc->disconnect(this);
+    if (m_proc->state() != QProcess::NotRunning) {
+        m_proc->kill();
+        m_proc->waitForFinished(1000);
+    }
+}
+
+void HunterWorker::start(const QString& program, int memoryLimit) {
+    m_proc->setMemoryLimit(memoryLimit);
+    m_proc->start(program, QStringList() << "--server");
+}
+
+void HunterWorker::send(int jobId, const QByteArray& dump, int deadline) {
+    m_jobId = jobId;
+    m_frames.reset();
+    m_proc->write(HunterFrame::encode(dump));
+    if (deadline > 0) {
+        m_deadline.start(deadline);
+    }
+}
+
+void HunterWorker::readStdout() {
+    m_frames.append(m_proc->readAllStandardOutput());
+    QByteArray result;
+    if (m_frames.takeFrame(result)) {
+        m_deadline.stop();
+        int jobId = m_jobId;
+        m_jobId = -1;
+        if (jobId >= 0) {
+            emit done(this, jobId, result);
+        }
+    } else if (m_frames.hasError()) {
+        /* we lost sync with the worker, so it is useless from now on */
+        failJob("malformed result frame");
+        m_proc->kill();
+    }
+}
+
+void HunterWorker::readStderr() {
+    emit stderrReceived(QString::fromUtf8(m_proc->readAllStandardError()));
+}
+
+void HunterWorker::deadlineExceeded() {
+    failJob("deadline exceeded");
+    m_proc->kill();
+}
+
+void HunterWorker::failJob(const QString& error) {
+    m_deadline.stop();
+    int jobId = m_jobId;
+    m_jobId = -1;
+    if (jobId >= 0) {
+        emit failed(this, jobId, error);
+    }
+}
+
+void HunterWorker::processFinished(int exitCode, QProcess::ExitStatus status) {
+    if (m_dead)
+        return;
+    m_dead = true;
+    failJob(status == QProcess::CrashExit
+            ? QString("hunter worker crashed")
+            : QString("hunter worker exited with code %1").arg(exitCode));
+    emit died(this);
+}
+
+void HunterWorker::processError(QProcess::ProcessError error) {
+    /* every other error is followed by finished() */
+    if (error != QProcess::FailedToStart || m_dead)
+        return;
+    m_dead = true;
+    failJob("failed to start hunter worker: " + m_proc->errorString());
+    emit died(this);
+}
+
+HunterPool::HunterPool(QObject* parent)
+    : QObject(parent)
+    , m_size(0)
+    , m_deadline(0)
+    , m_memoryLimit(0)
+    , m_nextJobId(0)
+    , m_pendingRespawns(0)
+{
+}
+
+HunterPool::~HunterPool() {
+    stop();
+}
+
+void HunterPool::configure(const QString& program, int size, int deadline, int memoryLimit) {
+    if (size < 1)
+        size = 1;
+    m_deadline = deadline;
+    if (program == m_program && size == m_size && memoryLimit == m_memoryLimit
+            && !m_workers.isEmpty()) {
+        return;
+    }
+    stop();
+    m_program = program;
+    m_size = size;
+    m_memoryLimit = memoryLimit;
+    for (int i = 0; i < m_size; i++) {
+        spawn();
+    }
+}
+
+void HunterPool::stop() {
+    for (int i = 0; i < m_workers.count(); i++) {
+        delete m_workers[i];
+    }
+    m_workers.clear();
+}
+
+HunterWorker* HunterPool::spawn() {
+    HunterWorker* worker = new HunterWorker(this);
+    connect(worker, SIGNAL(done(HunterWorker*, int, const QByteArray&)),
+            this, SLOT(workerDone(HunterWorker*, int, const QByteArray&)));
+    connect(worker, SIGNAL(failed(HunterWorker*, int, const QString&)),
+            this, SLOT(workerFailed(HunterWorker*, int, const QString&)));
+    connect(worker, SIGNAL(died(HunterWorker*)),
+            this, SLOT(workerDied(HunterWorker*)));
+    connect(worker, SIGNAL(stderrReceived(const QString&)),
+            this, SIGNAL(stderrReceived(const QString&)));
+    m_workers.append(worker);
+    worker->start(m_program, m_memoryLimit);
+    return worker;
+}
+
+int HunterPool::submit(const QByteArray& dump) {
+    Job job;
+    job.id = m_nextJobId++;
+    job.dump = dump;
+    m_queue.append(job);
+    dispatch();
+    return job.id;
+}
+
+void HunterPool::cancel(int jobId) {
+    for (int i = 0; i < m_queue.count(); i++) {
+        if (m_queue[i].id == jobId) {
+            m_queue.removeAt(i);
+            return;
+        }
+    }
+}
+
+void HunterPool::dispatch() {
+    for (int i = 0; i < m_workers.count() && !m_queue.isEmpty(); i++) {
+        HunterWorker* worker = m_workers[i];
+        if (!worker->isReady())
+            continue;
+        Job job = m_queue.takeFirst();
+        worker->send(job.id, job.dump, m_deadline);
+        emit started();
+    }
+}
+
+void HunterPool::workerDone(HunterWorker* worker, int jobId, const QByteArray& result) {
+    Q_UNUSED(worker);
+    emit resultReady(jobId, result);
+    dispatch();
+}
+
+void HunterPool::workerFailed(HunterWorker* worker, int jobId, const QString& error) {
+    Q_UNUSED(worker);
+    emit failed(jobId, error);
+}
+
+void HunterPool::workerDied(HunterWorker* worker) {
+    m_workers.removeAll(worker);
+    worker->deleteLater();
+    m_pendingRespawns++;
+    QTimer::singleShot(RESPAWN_DELAY, this, SLOT(respawn()));
+}
+
+void HunterPool::respawn() {
+    if (m_pendingRespawns <= 0)
+        return;
+    m_pendingRespawns--;
+    if (m_workers.count() < m_size) {
+        spawn();
+    }
+    /* the new worker starts asynchronously; the queue gets picked up
+     * once it is running */
+    QTimer::singleShot(0, this, SLOT(dispatch()));
+}
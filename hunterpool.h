@@ -0,0 +1,135 @@
+#ifndef HUNTER_POOL_H
+#define HUNTER_POOL_H
+
+#include <QtCore>
+
+#include "hunterprotocol.h"
+
+/* A QProcess which applies resource limits to the child right after
+ * fork(), so that a runaway hunter cannot starve the browser. */
+class HunterProcess : public QProcess {
+    Q_OBJECT
+public:
+    HunterProcess(QObject* parent = 0)
+        : QProcess(parent), m_memoryLimit(0), m_niceness(0) {}
+
+    /* address space limit in MB, 0 for none */
+    void setMemoryLimit(int mb) {
+        m_memoryLimit = mb;
+    }
+
+    void setNiceness(int niceness) {
+        m_niceness = niceness;
+    }
+
+protected:
+    virtual void setupChildProcess();
+
+private:
+    int m_memoryLimit;
+    int m_niceness;
+};
+
+/* One long-lived hunter started as "hunter --server". It reads dump
+ * frames from stdin in a loop and answers each with one result frame
+ * on stdout (see hunterprotocol.h). */
+class HunterWorker : public QObject {
+    Q_OBJECT
+public:
+    HunterWorker(QObject* parent = 0);
+    ~HunterWorker();
+
+    void start(const QString& program, int memoryLimit);
+
+    /* -1 when idle */
+    int jobId() const {
+        return m_jobId;
+    }
+
+    bool isReady() const {
+        return m_proc->state() != QProcess::NotRunning && m_jobId < 0;
+    }
+
+    void send(int jobId, const QByteArray& dump, int deadline);
+
+signals:
+    void done(HunterWorker* worker, int jobId, const QByteArray& result);
+    void failed(HunterWorker* worker, int jobId, const QString& error);
+    void died(HunterWorker* worker);
+    void stderrReceived(const QString& text);
+
+private slots:
+    void readStdout();
+    void readStderr();
+    void deadlineExceeded();
+    void processFinished(int exitCode, QProcess::ExitStatus status);
+    void processError(QProcess::ProcessError error);
+
+private:
+    void failJob(const QString& error);
+
+    HunterProcess* m_proc;
+    HunterFrameReader m_frames;
+    QTimer m_deadline;
+    int m_jobId;
+    bool m_dead;
+};
+
+/* A pool of HunterWorkers sharing one queue of dumps. Every job has
+ * a per-page deadline; a worker that misses it is killed and a fresh
+ * one spawned in its place. */
+class HunterPool : public QObject {
+    Q_OBJECT
+public:
+    HunterPool(QObject* parent = 0);
+    ~HunterPool();
+
+    /* (re)spawns the workers if anything changed */
+    void configure(const QString& program, int size, int deadline, int memoryLimit);
+
+    const QString& program() const {
+        return m_program;
+    }
+
+    /* Queue a dump for hunting and return the job id used by
+     * resultReady() and failed(). */
+    int submit(const QByteArray& dump);
+
+    /* Drop a job which has not been dispatched yet. */
+    void cancel(int jobId);
+
+signals:
+    /* a job has been handed to a worker */
+    void started();
+    void resultReady(int jobId, const QByteArray& result);
+    void failed(int jobId, const QString& error);
+    void stderrReceived(const QString& text);
+
+private slots:
+    void workerDone(HunterWorker* worker, int jobId, const QByteArray& result);
+    void workerFailed(HunterWorker* worker, int jobId, const QString& error);
+    void workerDied(HunterWorker* worker);
+    void respawn();
+    void dispatch();
+
+private:
+    struct Job {
+        int id;
+        QByteArray dump;
+    };
+
+    void stop();
+    HunterWorker* spawn();
+
+    QString m_program;
+    int m_size;
+    int m_deadline;
+    int m_memoryLimit;
+
+    QList<HunterWorker*> m_workers;
+    QList<Job> m_queue;
+    int m_nextJobId;
+    int m_pendingRespawns;
+};
+
+#endif // HUNTER_POOL_H
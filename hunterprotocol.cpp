@@ -0,0 +1,45 @@
+#include "hunterprotocol.h"
+
+/* no sane dump needs more digits than this */
+const static int MAX_FRAME_HEADER_LEN = 20;
+
+QByteArray HunterFrame::encode(const QByteArray& payload) {
+    QByteArray frame = QByteArray::number(payload.size());
+    frame.reserve(frame.size() + 1 + payload.size());
+    frame += '\n';
+    frame += payload;
+    return frame;
+}
+
+bool HunterFrameReader::takeFrame(QByteArray& frame) {
+    if (m_error) {
+        return false;
+    }
+
+    if (m_expected < 0) {
+        int nl = m_buffer.indexOf('\n');
+        if (nl < 0) {
+            if (m_buffer.size() > MAX_FRAME_HEADER_LEN) {
+                m_error = true;
+            }
+            return false;
+        }
+        bool ok;
+        m_expected = m_buffer.left(nl).trimmed().toLongLong(&ok);
+        if (!ok || m_expected < 0) {
+            m_error = true;
+            m_expected = -1;
+            return false;
+        }
+        m_buffer.remove(0, nl + 1);
+    }
+
+    if (m_buffer.size() < m_expected) {
+        return false;
+    }
+
+    frame = m_buffer.left(m_expected);
+    m_buffer.remove(0, m_expected);
+    m_expected = -1;
+    return true;
+}
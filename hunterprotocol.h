@@ -0,0 +1,57 @@
+#ifndef HUNTER_PROTOCOL_H
+#define HUNTER_PROTOCOL_H
+
+#include <QByteArray>
+
+/* Framing used when talking to hunters over pipes.
+ *
+ * Every message is the payload length as ASCII decimal digits, a
+ * single "\n", then exactly that many bytes of payload:
+ *
+ *     1234\n<1234 bytes>
+ *
+ * which is trivial to read from Perl:
+ *
+ *     my $len = <STDIN>; read(STDIN, my $buf, $len);
+ */
+class HunterFrame {
+public:
+    static QByteArray encode(const QByteArray& payload);
+};
+
+/* Incrementally reassembles frames out of arbitrarily split chunks
+ * of a byte stream (e.g. what QProcess::readyRead hands us). */
+class HunterFrameReader {
+public:
+    HunterFrameReader() : m_expected(-1), m_error(false) {}
+
+    void reset() {
+        m_buffer.clear();
+        m_expected = -1;
+        m_error = false;
+    }
+
+    void append(const QByteArray& data) {
+        m_buffer.append(data);
+    }
+
+    /* Returns true and fills frame if a complete frame is buffered. */
+    bool takeFrame(QByteArray& frame);
+
+    /* Set once a malformed length header has been seen. */
+    bool hasError() const {
+        return m_error;
+    }
+
+    /* Number of bytes buffered but not yet returned as a frame. */
+    int pending() const {
+        return m_buffer.size();
+    }
+
+private:
+    QByteArray m_buffer;
+    qint64 m_expected;
+    bool m_error;
+};
+
+#endif // HUNTER_PROTOCOL_H
@@ -0,0 +1,101 @@
+#include "hunterresultcache.h"
+#include "logger.h"
+
+#include <QDesktopServices>
+#include <QtConcurrentRun>
+#include <cstdio>
+
+QString HunterResultCache::s_defaultDir;
+
+/* runs on the pool */
+static void writeEntry(const QString& path, const QByteArray& data) {
+    QString dir = QFileInfo(path).path();
+    if (!QDir().mkpath(dir)) {
+        return;
+    }
+    /* a reader must never see half a result, and two stores of one
+     * key must not write to the same temporary file */
+    QTemporaryFile file(dir + "/XXXXXX.tmp");
+    file.setAutoRemove(false);
+    if (!file.open() || file.write(data) != data.size()) {
+        VDOM_LOG(Hunter, Warning, QString("Cannot cache hunter result in %1: %2")
+                .arg(dir).arg(file.errorString()));
+        file.remove();
+        return;
+    }
+    file.close();
+    /* rename(2) replaces an entry stored meanwhile in one step */
+    if (::rename(QFile::encodeName(file.fileName()).constData(),
+                 QFile::encodeName(path).constData()) != 0) {
+        file.remove();
+    }
+}
+
+HunterResultCache::HunterResultCache(const QString& dir)
+    : m_dir(dir.isEmpty() ? s_defaultDir : dir)
+    , m_hits(0)
+    , m_misses(0)
+{
+    if (m_dir.isEmpty()) {
+        QString cache = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+        if (!cache.isEmpty()) {
+            m_dir = QDir(cache).filePath("hunter-results");
+        }
+    } else if (m_dir == "off") {
+        m_dir.clear();
+    }
+}
+
+QByteArray HunterResultCache::key(const QByteArray& dumpSha1, const QString& hunterPath) const {
+    if (!isEnabled() || dumpSha1.isEmpty()) {
+        return QByteArray();
+    }
+    QFileInfo hunter(hunterPath);
+    if (!hunter.isFile()) {
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(dumpSha1);
+    hash.addData(hunter.absoluteFilePath().toUtf8());
+    hash.addData("\n" + QByteArray::number(hunter.size()));
+    hash.addData("\n" + QByteArray::number(hunter.lastModified().toTime_t()));
+    return hash.result().toHex();
+}
+
+QString HunterResultCache::path(const QByteArray& key) const {
+    return QString("%1/%2/%3").arg(m_dir)
+        .arg(QString::fromLatin1(key.left(2)))
+        .arg(QString::fromLatin1(key.mid(2)));
+}
+
+QString HunterResultCache::lookup(const QByteArray& key) {
+    if (key.isEmpty()) {
+        return QString();
+    }
+    QString file = path(key);
+    if (QFile::exists(file)) {
+        m_hits++;
+        return file;
+    }
+    m_misses++;
+    return QString();
+}
+
+void HunterResultCache::storeFile(const QByteArray& key, const QString& source) {
+    if (key.isEmpty())
+        return;
+    /* now: the next hunt rewrites the file in place */
+    QFile in(source);
+    if (!in.open(QIODevice::ReadOnly)) {
+        VDOM_LOG(Hunter, Warning, QString("Cannot cache hunter result %1: %2")
+                .arg(source).arg(in.errorString()));
+        return;
+    }
+    storeData(key, in.readAll());
+}
+
+void HunterResultCache::storeData(const QByteArray& key, const QByteArray& data) {
+    if (key.isEmpty())
+        return;
+    QtConcurrent::run(writeEntry, path(key), data);
+}
@@ -0,0 +1,58 @@
+#ifndef HUNTER_RESULT_CACHE_H
+#define HUNTER_RESULT_CACHE_H
+
+#include <QtCore>
+
+/* Hunter results on disk, addressed by what they were computed from.
+ *
+ * The key of a result is the SHA-1 over the SHA-1 of the text dump,
+ * the hunter path and the size and mtime of the hunter program, so
+ * a rebuilt hunter never gets served the results of the old one. A
+ * hunter which is not a file we can stat (e.g. found in $PATH) is
+ * not cached. Results live in <dir>/<2 hex digits>/<rest of the key>
+ * and are written on the thread pool, each under a temporary name of
+ * its own first. */
+class HunterResultCache {
+public:
+    /* dir: where the results go, empty for the default cache
+     * location; "off" disables caching */
+    HunterResultCache(const QString& dir = QString());
+
+    static void setDefaultDirectory(const QString& dir) {
+        s_defaultDir = dir;
+    }
+
+    bool isEnabled() const {
+        return !m_dir.isEmpty();
+    }
+
+    /* empty if the result of this hunter cannot be cached */
+    QByteArray key(const QByteArray& dumpSha1, const QString& hunterPath) const;
+
+    /* the file holding the result for key, empty on a miss; counts
+     * the hit or miss */
+    QString lookup(const QByteArray& key);
+
+    /* save a result file, read right away, or result data for key */
+    void storeFile(const QByteArray& key, const QString& path);
+    void storeData(const QByteArray& key, const QByteArray& data);
+
+    int hits() const {
+        return m_hits;
+    }
+
+    int misses() const {
+        return m_misses;
+    }
+
+private:
+    QString path(const QByteArray& key) const;
+
+    static QString s_defaultDir;
+
+    QString m_dir;
+    int m_hits;
+    int m_misses;
+};
+
+#endif // HUNTER_RESULT_CACHE_H
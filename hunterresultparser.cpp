@@ -0,0 +1,385 @@
+#include "hunterresultparser.h"
+
+#include <climits>
+
+/* bytes pulled from the device at a time */
+const static int READ_CHUNK = 64 * 1024;
+
+/* groups per groupsParsed() batch */
+const static int GROUP_BATCH = 64;
+
+const static int MAX_DEPTH = 512;
+
+/* A minimal pull parser for JSON over a QIODevice which only keeps a
+ * small window of the input in memory. */
+class JsonStream {
+public:
+    JsonStream(QIODevice* dev) : m_dev(dev), m_pos(0), m_line(1) {}
+
+    int peek() {
+        if (m_pos >= m_buf.size() && !fill())
+            return -1;
+        return (uchar) m_buf.at(m_pos);
+    }
+
+    int next() {
+        if (m_pos >= m_buf.size() && !fill())
+            return -1;
+        char c = m_buf.at(m_pos++);
+        if (c == '\n')
+            m_line++;
+        return (uchar) c;
+    }
+
+    int skipSpace() {
+        int c;
+        while ((c = peek()) == ' ' || c == '\t' || c == '\n' || c == '\r')
+            next();
+        return c;
+    }
+
+    bool expect(char c) {
+        if (skipSpace() != c) {
+            return error(QString("'%1' expected").arg(c));
+        }
+        next();
+        return true;
+    }
+
+    bool parseValue(QVariant& value, int depth = 0);
+    bool parseString(QString& str);
+
+    bool error(const QString& msg) {
+        if (m_error.isEmpty())
+            m_error = msg;
+        return false;
+    }
+
+    bool hasError() const {
+        return !m_error.isEmpty();
+    }
+
+    const QString& errorString() const {
+        return m_error;
+    }
+
+    int line() const {
+        return m_line;
+    }
+
+private:
+    bool fill() {
+        m_buf = m_dev->read(READ_CHUNK);
+        m_pos = 0;
+        return !m_buf.isEmpty();
+    }
+
+    bool parseNumber(QVariant& value);
+    bool parseLiteral(const char* word, const QVariant& literal, QVariant& value);
+    bool parseHex4(ushort& u);
+
+    QIODevice* m_dev;
+    QByteArray m_buf;
+    int m_pos;
+    int m_line;
+    QString m_error;
+};
+
+bool JsonStream::parseValue(QVariant& value, int depth) {
+    if (depth > MAX_DEPTH) {
+        return error("nesting too deep");
+    }
+    int c = skipSpace();
+    switch (c) {
+    case '{': {
+        next();
+        QVariantMap map;
+        if (skipSpace() == '}') {
+            next();
+            value = map;
+            return true;
+        }
+        while (true) {
+            QString key;
+            if (skipSpace() != '"')
+                return error("object key expected");
+            if (!parseString(key) || !expect(':'))
+                return false;
+            QVariant v;
+            if (!parseValue(v, depth + 1))
+                return false;
+            map.insert(key, v);
+            c = skipSpace();
+            next();
+            if (c == '}')
+                break;
+            if (c != ',')
+                return error("',' or '}' expected");
+        }
+        value = map;
+        return true;
+    }
+    case '[': {
+        next();
+        QVariantList list;
+        if (skipSpace() == ']') {
+            next();
+            value = list;
+            return true;
+        }
+        while (true) {
+            QVariant v;
+            if (!parseValue(v, depth + 1))
+                return false;
+            list.append(v);
+            c = skipSpace();
+            next();
+            if (c == ']')
+                break;
+            if (c != ',')
+                return error("',' or ']' expected");
+        }
+        value = list;
+        return true;
+    }
+    case '"': {
+        QString str;
+        if (!parseString(str))
+            return false;
+        value = str;
+        return true;
+    }
+    case 't':
+        return parseLiteral("true", QVariant(true), value);
+    case 'f':
+        return parseLiteral("false", QVariant(false), value);
+    case 'n':
+        return parseLiteral("null", QVariant(), value);
+    case -1:
+        return error("unexpected end of input");
+    default:
+        if (c == '-' || (c >= '0' && c <= '9'))
+            return parseNumber(value);
+        return error(QString("unexpected character '%1'").arg(QChar(c)));
+    }
+}
+
+bool JsonStream::parseLiteral(const char* word, const QVariant& literal, QVariant& value) {
+    for (const char* p = word; *p; p++) {
+        if (next() != *p)
+            return error(QString("invalid literal, %1 expected").arg(word));
+    }
+    value = literal;
+    return true;
+}
+
+bool JsonStream::parseNumber(QVariant& value) {
+    QByteArray num;
+    bool isDouble = false;
+    int c;
+    while ((c = peek()) != -1) {
+        if (c == '.' || c == 'e' || c == 'E') {
+            isDouble = true;
+        } else if (!(c == '-' || c == '+' || (c >= '0' && c <= '9'))) {
+            break;
+        }
+        num += (char) next();
+    }
+    bool ok;
+    if (!isDouble) {
+        qlonglong n = num.toLongLong(&ok);
+        if (ok) {
+            if (n >= INT_MIN && n <= INT_MAX) {
+                value = QVariant((int) n);
+            } else {
+                value = QVariant(n);
+            }
+            return true;
+        }
+    }
+    double d = num.toDouble(&ok);
+    if (!ok)
+        return error("invalid number " + QString::fromLatin1(num));
+    value = QVariant(d);
+    return true;
+}
+
+bool JsonStream::parseHex4(ushort& u) {
+    u = 0;
+    for (int i = 0; i < 4; i++) {
+        int c = next();
+        u <<= 4;
+        if (c >= '0' && c <= '9') {
+            u |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            u |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            u |= c - 'A' + 10;
+        } else {
+            return error("invalid \\u escape");
+        }
+    }
+    return true;
+}
+
+bool JsonStream::parseString(QString& str) {
+    next(); /* the opening quote */
+    QByteArray raw;
+    while (true) {
+        int c = next();
+        if (c == -1)
+            return error("unterminated string");
+        if (c == '"')
+            break;
+        if (c != '\\') {
+            raw += (char) c;
+            continue;
+        }
+        c = next();
+        switch (c) {
+        case '"':  raw += '"'; break;
+        case '\\': raw += '\\'; break;
+        case '/':  raw += '/'; break;
+        case 'b':  raw += '\b'; break;
+        case 'f':  raw += '\f'; break;
+        case 'n':  raw += '\n'; break;
+        case 'r':  raw += '\r'; break;
+        case 't':  raw += '\t'; break;
+        case 'u': {
+            ushort u;
+            if (!parseHex4(u))
+                return false;
+            QString ch = QChar(u);
+            if (QChar(u).isHighSurrogate() && peek() == '\\') {
+                next();
+                ushort low;
+                if (next() != 'u' || !parseHex4(low))
+                    return error("invalid surrogate pair");
+                ch += QChar(low);
+            }
+            raw += ch.toUtf8();
+            break;
+        }
+        default:
+            return error("invalid escape sequence");
+        }
+    }
+    str = QString::fromUtf8(raw);
+    return true;
+}
+
+void HunterResultParser::parseFile(int id, const QString& path) {
+    if (m_latest != id)
+        return;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit failed(id, QString("Failed to load hunter result file %1: %2")
+                .arg(path).arg(file.errorString()));
+        return;
+    }
+    parse(id, &file, path);
+}
+
+void HunterResultParser::parseData(int id, const QByteArray& data, const QString& source) {
+    if (m_latest != id)
+        return;
+    QByteArray copy(data);
+    QBuffer buffer(&copy);
+    buffer.open(QIODevice::ReadOnly);
+    parse(id, &buffer, source);
+}
+
+void HunterResultParser::parse(int id, QIODevice* dev, const QString& source) {
+    JsonStream in(dev);
+    QVariantMap root;
+
+    int c = in.skipSpace();
+    if (c == -1) {
+        emit failed(id, QString("Result from %1 is empty.").arg(source));
+        return;
+    }
+    if (c != '{') {
+        emit failed(id, QString("Result from %1 does not contain a JSON object.")
+                .arg(source));
+        return;
+    }
+    in.next();
+
+    bool ok = true;
+    if (in.skipSpace() == '}') {
+        in.next();
+    } else {
+        while (ok) {
+            QString key;
+            if (in.skipSpace() != '"') {
+                ok = in.error("object key expected");
+                break;
+            }
+            if (!in.parseString(key) || !in.expect(':')) {
+                ok = false;
+                break;
+            }
+
+            if (key == "groups" && in.skipSpace() == '[') {
+                /* stream the groups out in batches */
+                in.next();
+                QVariantList batch;
+                int offset = 0;
+                if (in.skipSpace() == ']') {
+                    in.next();
+                } else {
+                    while (true) {
+                        QVariant group;
+                        if (!in.parseValue(group, 1)) {
+                            ok = false;
+                            break;
+                        }
+                        batch.append(group);
+                        if (batch.count() >= GROUP_BATCH) {
+                            if (m_latest != id)
+                                return;
+                            emit groupsParsed(id, offset, batch);
+                            offset += batch.count();
+                            batch.clear();
+                        }
+                        c = in.skipSpace();
+                        in.next();
+                        if (c == ']')
+                            break;
+                        if (c != ',') {
+                            ok = in.error("',' or ']' expected");
+                            break;
+                        }
+                    }
+                }
+                if (!ok)
+                    break;
+                if (!batch.isEmpty()) {
+                    emit groupsParsed(id, offset, batch);
+                }
+            } else {
+                QVariant value;
+                if (!in.parseValue(value, 1)) {
+                    ok = false;
+                    break;
+                }
+                root.insert(key, value);
+            }
+
+            c = in.skipSpace();
+            in.next();
+            if (c == '}')
+                break;
+            if (c != ',') {
+                ok = in.error("',' or '}' expected");
+            }
+        }
+    }
+
+    if (!ok) {
+        emit failed(id, QString("Failed to parse JSON in %1: line %2: %3")
+                .arg(source).arg(in.line()).arg(in.errorString()));
+        return;
+    }
+    emit finished(id, root);
+}
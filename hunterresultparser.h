@@ -0,0 +1,41 @@
+#ifndef HUNTER_RESULT_PARSER_H
+#define HUNTER_RESULT_PARSER_H
+
+#include <QtCore>
+
+/* Parses hunter results on a worker thread.
+ *
+ * The result is read and decoded incrementally. The elements of the
+ * top-level "groups" array are handed out in batches through
+ * groupsParsed() as soon as they are decoded, so the GUI can start
+ * annotating while the rest is still being parsed. Every other
+ * top-level key ends up in the map passed to finished().
+ *
+ * Each parse carries an id; starting a new parse with supersede()
+ * makes the parser abandon older ones early. */
+class HunterResultParser : public QObject {
+    Q_OBJECT
+public:
+    HunterResultParser() : m_latest(-1) {}
+
+    /* thread-safe: mark every parse but id as stale */
+    void supersede(int id) {
+        m_latest.fetchAndStoreOrdered(id);
+    }
+
+public slots:
+    void parseFile(int id, const QString& path);
+    void parseData(int id, const QByteArray& data, const QString& source);
+
+signals:
+    void groupsParsed(int id, int offset, const QVariantList& groups);
+    void finished(int id, const QVariantMap& root);
+    void failed(int id, const QString& error);
+
+private:
+    void parse(int id, QIODevice* dev, const QString& source);
+
+    QAtomicInt m_latest;
+};
+
+#endif // HUNTER_RESULT_PARSER_H
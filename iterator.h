@@ -16,6 +16,26 @@ public:
         m_cur = -1;
     }
 
+    /* grow or shrink the range while keeping the current position,
+     * e.g. while the list behind us is still being indexed */
+    void updateCount(int count) {
+        m_count = count;
+        if (m_cur >= m_count) {
+            m_cur = m_count - 1;
+        }
+    }
+
+    int count() const {
+        return m_count;
+    }
+
+    int jumpTo(int index) {
+        if (index < 0 || index >= m_count) {
+            return m_cur;
+        }
+        return (m_cur = index);
+    }
+
     int prev() {
         if (m_count <= 0) {
             return (m_cur = -1);
@@ -27,6 +27,24 @@ IteratorConfigDialog::IteratorConfigDialog(QWidget *parent): QDialog(parent) {
             this, SLOT(browseListFile()));
     formLayout->addWidget(button, 0, 2);
 
+    label = new QLabel(tr("&Prefetch pages"), this);
+    formLayout->addWidget(label, 1, 0);
+
+    m_prefetchPagesSpin = new QSpinBox(this);
+    m_prefetchPagesSpin->setRange(0, 2);
+    m_prefetchPagesSpin->setSpecialValueText(tr("Off"));
+    formLayout->addWidget(m_prefetchPagesSpin, 1, 1);
+    label->setBuddy(m_prefetchPagesSpin);
+
+    label = new QLabel(tr("Prefetch &memory"), this);
+    formLayout->addWidget(label, 2, 0);
+
+    m_prefetchMemorySpin = new QSpinBox(this);
+    m_prefetchMemorySpin->setRange(16, 4096);
+    m_prefetchMemorySpin->setSuffix(tr(" MB"));
+    formLayout->addWidget(m_prefetchMemorySpin, 2, 1);
+    label->setBuddy(m_prefetchMemorySpin);
+
     formLayout->setSpacing(20);
 
     layout->addWidget(m_formGroup);
@@ -49,7 +67,7 @@ IteratorConfigDialog::IteratorConfigDialog(QWidget *parent): QDialog(parent) {
     //layout->addStretch();
 
     setLayout(layout);
-    setFixedSize(QSize(700, 150));
+    setFixedSize(QSize(700, 240));
     setWindowTitle(tr("URL Iterator Configuration"));
 }
 
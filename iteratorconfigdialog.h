@@ -27,6 +27,23 @@ public:
         return m_listFileEdit->text().trimmed();
     }
 
+    void setPrefetchPages(int pages) {
+        m_prefetchPagesSpin->setValue(pages);
+    }
+
+    int prefetchPages() const {
+        return m_prefetchPagesSpin->value();
+    }
+
+    /* in MB */
+    void setPrefetchMemory(int mb) {
+        m_prefetchMemorySpin->setValue(mb);
+    }
+
+    int prefetchMemory() const {
+        return m_prefetchMemorySpin->value();
+    }
+
 public slots:
     virtual void accept();
     void browseListFile();
@@ -37,6 +54,8 @@ private:
             msg, QMessageBox::NoButton);
     }
     QLineEdit* m_listFileEdit;
+    QSpinBox* m_prefetchPagesSpin;
+    QSpinBox* m_prefetchMemorySpin;
     QGroupBox* m_formGroup;
 };
 
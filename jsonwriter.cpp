@@ -0,0 +1,130 @@
+#include "jsonwriter.h"
+
+#include <QStringList>
+#include <cmath>
+
+QByteArray JsonWriter::toJson(const QVariant& value) {
+    QByteArray out;
+    write(out, value);
+    return out;
+}
+
+QByteArray JsonWriter::quote(const QString& str) {
+    QByteArray out;
+    writeString(out, str);
+    return out;
+}
+
+void JsonWriter::write(QByteArray& out, const QVariant& value) {
+    switch (value.type()) {
+    case QVariant::Invalid:
+        out += "null";
+        break;
+    case QVariant::Bool:
+        out += value.toBool() ? "true" : "false";
+        break;
+    case QVariant::Int:
+    case QVariant::LongLong:
+        out += QByteArray::number(value.toLongLong());
+        break;
+    case QVariant::UInt:
+    case QVariant::ULongLong:
+        out += QByteArray::number(value.toULongLong());
+        break;
+    case QVariant::Double: {
+        double d = value.toDouble();
+        if (std::isnan(d) || std::isinf(d)) {
+            out += "null";
+        } else {
+            out += QByteArray::number(d, 'g', 15);
+        }
+        break;
+    }
+    case QVariant::List: {
+        const QVariantList list = value.toList();
+        out += '[';
+        for (int i = 0; i < list.count(); i++) {
+            if (i > 0)
+                out += ',';
+            write(out, list.at(i));
+        }
+        out += ']';
+        break;
+    }
+    case QVariant::StringList: {
+        const QStringList list = value.toStringList();
+        out += '[';
+        for (int i = 0; i < list.count(); i++) {
+            if (i > 0)
+                out += ',';
+            writeString(out, list.at(i));
+        }
+        out += ']';
+        break;
+    }
+    case QVariant::Map: {
+        const QVariantMap map = value.toMap();
+        out += '{';
+        QVariantMap::const_iterator it;
+        for (it = map.constBegin(); it != map.constEnd(); ++it) {
+            if (it != map.constBegin())
+                out += ',';
+            writeString(out, it.key());
+            out += ':';
+            write(out, it.value());
+        }
+        out += '}';
+        break;
+    }
+    default:
+        if (value.isNull()) {
+            out += "null";
+        } else {
+            writeString(out, value.toString());
+        }
+        break;
+    }
+}
+
+void JsonWriter::writeString(QByteArray& out, const QString& str) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    const QChar* p = str.constData();
+    const QChar* end = p + str.length();
+    for (; p != end; p++) {
+        ushort c = p->unicode();
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default:
+            /* U+2028/U+2029 are valid in JSON but terminate lines in
+             * JavaScript source; '<' keeps "</script>" harmless */
+            if (c < 0x20 || c == 0x2028 || c == 0x2029 || c == '<') {
+                out += "\\u";
+                out += hex[(c >> 12) & 0xf];
+                out += hex[(c >> 8) & 0xf];
+                out += hex[(c >> 4) & 0xf];
+                out += hex[c & 0xf];
+            } else if (c < 0x80) {
+                out += (char) c;
+            } else {
+                /* convert the whole non-ASCII run at once so that
+                 * surrogate pairs stay together */
+                const QChar* q = p;
+                while (q != end && q->unicode() >= 0x80
+                        && q->unicode() != 0x2028 && q->unicode() != 0x2029) {
+                    q++;
+                }
+                out += QString(p, q - p).toUtf8();
+                p = q - 1;
+            }
+            break;
+        }
+    }
+    out += '"';
+}
@@ -0,0 +1,20 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <QVariant>
+#include <QByteArray>
+
+/* Serializes QVariant trees (as produced by HunterResultParser) back to
+ * compact JSON. The output is also safe to embed in JavaScript source
+ * passed to evaluateJavaScript(). */
+class JsonWriter {
+public:
+    static QByteArray toJson(const QVariant& value);
+    static QByteArray quote(const QString& str);
+
+private:
+    static void write(QByteArray& out, const QVariant& value);
+    static void writeString(QByteArray& out, const QString& str);
+};
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,88 @@
+#include "logconsole.h"
+#include "logger.h"
+
+const static int FLUSH_INTERVAL = 100;
+
+LogConsole::LogConsole(QWidget* parent)
+    : QPlainTextEdit(parent), m_maxLines(1000)
+{
+    setReadOnly(true);
+    setUndoRedoEnabled(false);
+    setLineWrapMode(QPlainTextEdit::NoWrap);
+    setMaximumBlockCount(m_maxLines);
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FLUSH_INTERVAL);
+    connect(&m_flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+void LogConsole::setMaximumLines(int lines) {
+    if (lines < 1)
+        lines = 1;
+    m_maxLines = lines;
+    setMaximumBlockCount(lines);
+}
+
+bool LogConsole::setSpillFile(const QString& path) {
+    if (m_spill.isOpen()) {
+        m_spill.close();
+    }
+    m_spill.setFileName(path);
+    if (path.isEmpty()) {
+        return true;
+    }
+    if (!m_spill.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        VDOM_LOG(Hunter, Warning, QString("Failed to open log file %1: %2")
+                .arg(path).arg(m_spill.errorString()));
+        return false;
+    }
+    return true;
+}
+
+void LogConsole::append(const QString& text) {
+    if (text.isEmpty())
+        return;
+
+    if (m_spill.isOpen()) {
+        m_spill.write(text.toUtf8());
+        if (!text.endsWith('\n'))
+            m_spill.write("\n", 1);
+    }
+
+    QString chunk = text;
+    if (chunk.endsWith('\n'))
+        chunk.chop(1);
+    m_pending += chunk.split('\n');
+
+    /* anything beyond the cap would be dropped by the document right
+     * away, so do not even keep it around */
+    while (m_pending.count() > m_maxLines)
+        m_pending.removeFirst();
+
+    if (!m_flushTimer.isActive())
+        m_flushTimer.start();
+}
+
+void LogConsole::clear() {
+    m_pending.clear();
+    m_flushTimer.stop();
+    QPlainTextEdit::clear();
+}
+
+void LogConsole::flush() {
+    if (m_pending.isEmpty())
+        return;
+
+    QScrollBar* bar = verticalScrollBar();
+    bool atBottom = bar->value() == bar->maximum();
+
+    appendPlainText(m_pending.join("\n"));
+    m_pending.clear();
+
+    if (m_spill.isOpen())
+        m_spill.flush();
+
+    /* follow the tail unless the user scrolled up to read */
+    if (atBottom)
+        bar->setValue(bar->maximum());
+}
@@ -0,0 +1,45 @@
+#ifndef LOG_CONSOLE_H
+#define LOG_CONSOLE_H
+
+#include <QtGui>
+
+/* A read-only console for chatty child processes.
+ *
+ * Appends are buffered and flushed to the widget at most every
+ * FLUSH_INTERVAL ms in a single edit, and the document keeps no more
+ * than maximumLines() lines, dropping the oldest ones. Optionally the
+ * complete, untruncated stream is spilled to a log file as well. */
+class LogConsole : public QPlainTextEdit {
+    Q_OBJECT
+public:
+    LogConsole(QWidget* parent = 0);
+
+    void setMaximumLines(int lines);
+
+    int maximumLines() const {
+        return m_maxLines;
+    }
+
+    /* Start spilling everything appended from now on to the given
+     * file, closing the previous one. An empty path stops spilling. */
+    bool setSpillFile(const QString& path);
+
+    QString spillFile() const {
+        return m_spill.fileName();
+    }
+
+public slots:
+    void append(const QString& text);
+    void clear();
+
+private slots:
+    void flush();
+
+private:
+    QStringList m_pending;
+    QTimer m_flushTimer;
+    int m_maxLines;
+    QFile m_spill;
+};
+
+#endif // LOG_CONSOLE_H
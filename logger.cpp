@@ -0,0 +1,259 @@
+#include "logger.h"
+#include "jsonwriter.h"
+
+#include <cstdio>
+#include <sys/time.h>
+#include <time.h>
+
+/* how often the writer wakes up to write out what was logged */
+const static int FLUSH_INTERVAL = 200;
+
+/* records waiting for the writer before new ones are dropped */
+const static int MAX_QUEUED = 100000;
+
+const static char* const LEVEL_NAMES[] = {
+    "debug", "info", "warning", "error", "off"
+};
+
+const static char* const CATEGORY_NAMES[] = {
+    "general", "console", "network", "hunter", "batch", "bridge"
+};
+
+int Logger::s_levels[Logger::CategoryCount] = {
+    Logger::Info, Logger::Info, Logger::Info,
+    Logger::Info, Logger::Info, Logger::Info
+};
+
+int Logger::s_consoleRate = 50;
+
+class LogWriter : public QThread {
+public:
+    LogWriter(Logger* logger) : m_logger(logger) {}
+
+protected:
+    virtual void run() {
+        QMutexLocker locker(&m_logger->m_mutex);
+        while (!m_logger->m_stopping) {
+            m_logger->m_wake.wait(&m_logger->m_mutex, FLUSH_INTERVAL);
+            m_logger->drain();
+        }
+        m_logger->drain();
+    }
+
+private:
+    Logger* m_logger;
+};
+
+/* wall clock in milliseconds since the epoch */
+static qint64 wallTime() {
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return qint64(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+}
+
+Logger* Logger::instance() {
+    static Logger* logger = 0;
+    if (!logger) {
+        logger = new Logger;
+    }
+    return logger;
+}
+
+Logger::Logger()
+    : m_head(0)
+    , m_queued(0)
+    , m_dropped(0)
+    , m_stopping(false)
+    , m_maxBytes(0)
+    , m_keep(0)
+{
+    m_writer = new LogWriter(this);
+    m_writer->start(QThread::LowPriority);
+}
+
+qint64 Logger::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int parseLevel(const QString& name) {
+    for (int i = 0; i <= Logger::Off; i++) {
+        if (name == LEVEL_NAMES[i])
+            return i;
+    }
+    return -1;
+}
+
+bool Logger::setLevels(const QString& spec) {
+    QStringList items = spec.split(',', QString::SkipEmptyParts);
+    if (items.isEmpty())
+        return false;
+    for (int i = 0; i < items.count(); i++) {
+        QStringList pair = items[i].trimmed().split('=');
+        int level = parseLevel(pair.last().trimmed().toLower());
+        if (level < 0 || pair.count() > 2)
+            return false;
+        if (pair.count() == 1) {
+            for (int c = 0; c < CategoryCount; c++)
+                s_levels[c] = level;
+            continue;
+        }
+        QString name = pair[0].trimmed().toLower();
+        int category = 0;
+        while (category < CategoryCount && name != CATEGORY_NAMES[category])
+            category++;
+        if (category == CategoryCount)
+            return false;
+        s_levels[category] = level;
+    }
+    return true;
+}
+
+bool Logger::open(const QString& path, qint64 maxBytes, int keep) {
+    QMutexLocker locker(&m_mutex);
+    if (m_file.isOpen())
+        m_file.close();
+    m_maxBytes = maxBytes;
+    m_keep = keep;
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        m_errorString = QString("Cannot write log file %1: %2")
+            .arg(path).arg(m_file.errorString());
+        return false;
+    }
+    return true;
+}
+
+void Logger::log(int category, int level, const QString& message,
+                 const QString& page) {
+    if (m_queued.fetchAndAddRelaxed(1) >= MAX_QUEUED) {
+        m_queued.fetchAndAddRelaxed(-1);
+        m_dropped.fetchAndAddRelaxed(1);
+        return;
+    }
+    Record* record = new Record;
+    record->time = wallTime();
+    record->category = category;
+    record->level = level;
+    record->message = message;
+    record->page = page;
+
+    /* push; the writer only ever takes the whole stack, so there is
+     * no ABA problem */
+    Record* head;
+    do {
+        head = m_head;
+        record->next = head;
+    } while (!m_head.testAndSetRelease(head, record));
+}
+
+void Logger::close() {
+    if (m_writer->isRunning()) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_stopping = true;
+            m_wake.wakeOne();
+        }
+        m_writer->wait();
+    }
+    for (int c = 0; c < CategoryCount; c++)
+        s_levels[c] = Off;
+    m_file.close();
+}
+
+void Logger::drain() {
+    /* the stack is newest first */
+    Record* list = m_head.fetchAndStoreAcquire(0);
+    Record* ordered = 0;
+    int count = 0;
+    while (list) {
+        Record* next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+        count++;
+    }
+    m_queued.fetchAndAddRelaxed(-count);
+
+    int dropped = m_dropped.fetchAndStoreRelaxed(0);
+    if (dropped > 0) {
+        Record record;
+        record.time = wallTime();
+        record.category = General;
+        record.level = Warning;
+        record.message = QString("%1 log records dropped").arg(dropped);
+        write(&record);
+    }
+    while (ordered) {
+        Record* next = ordered->next;
+        write(ordered);
+        delete ordered;
+        ordered = next;
+    }
+    if (count > 0 || dropped > 0) {
+        if (m_file.isOpen())
+            m_file.flush();
+        else
+            fflush(stderr);
+    }
+}
+
+void Logger::write(const Record* record) {
+    if (!m_file.isOpen()) {
+        QByteArray line = QByteArray("[") + LEVEL_NAMES[record->level] + " "
+            + CATEGORY_NAMES[record->category] + "] ";
+        if (!record->page.isEmpty())
+            line += record->page.toUtf8() + ": ";
+        line += record->message.toUtf8() + "\n";
+        fwrite(line.constData(), 1, line.size(), stderr);
+        return;
+    }
+    QByteArray line = "{\"time\":" + QByteArray::number(record->time)
+        + ",\"level\":\"" + LEVEL_NAMES[record->level]
+        + "\",\"category\":\"" + CATEGORY_NAMES[record->category] + "\"";
+    if (!record->page.isEmpty())
+        line += ",\"page\":" + JsonWriter::quote(record->page);
+    line += ",\"message\":" + JsonWriter::quote(record->message) + "}\n";
+    if (m_maxBytes > 0 && m_file.size() > 0 &&
+            m_file.size() + line.size() > m_maxBytes) {
+        rotate();
+    }
+    m_file.write(line);
+}
+
+void Logger::rotate() {
+    QString path = m_file.fileName();
+    m_file.close();
+    if (m_keep > 0)
+        QFile::remove(QString("%1.%2").arg(path).arg(m_keep));
+    for (int i = m_keep - 1; i >= 1; i--) {
+        QFile::rename(QString("%1.%2").arg(path).arg(i),
+                      QString("%1.%2").arg(path).arg(i + 1));
+    }
+    if (m_keep > 0)
+        QFile::rename(path, path + ".1");
+    else
+        QFile::remove(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        fprintf(stderr, "Cannot write log file %s: %s\n", path.toUtf8().data(),
+                m_file.errorString().toUtf8().data());
+    }
+}
+
+bool LogRateLimiter::allow() {
+    int rate = Logger::consoleRate();
+    if (rate <= 0)
+        return true;
+    qint64 now = Logger::now();
+    if (now - m_windowStart >= 1000) {
+        m_windowStart = now;
+        m_count = 0;
+    }
+    if (m_count < rate) {
+        m_count++;
+        return true;
+    }
+    m_dropped++;
+    return false;
+}
@@ -0,0 +1,140 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QtCore>
+
+/* Leveled, categorized logging that stays off the caller's back.
+ *
+ * log() only links a record into a lock-free stack; a writer thread
+ * takes the whole stack every FLUSH_INTERVAL ms and writes it out in
+ * order, as text lines to stderr or, after open(), as JSON lines to a
+ * file which is rotated at a size limit. Should the writer fall
+ * behind by MAX_QUEUED records, new ones are dropped and counted.
+ *
+ * Log through VDOM_LOG(): when the level of the category is off, all
+ * it costs is a test against a static table, and the message is not
+ * even built. */
+class Logger {
+public:
+    enum Level {
+        Debug = 0,
+        Info,
+        Warning,
+        Error,
+        Off
+    };
+
+    enum Category {
+        General = 0,
+        Console,    /* JavaScript console messages */
+        Network,
+        Hunter,
+        Batch,
+        Bridge,     /* file and process access of page scripts */
+        CategoryCount
+    };
+
+    static Logger* instance();
+
+    static bool isEnabled(int category, int level) {
+        return level >= s_levels[category];
+    }
+
+    /* "warning" for every category, or a list of them such as
+     * "console=off,network=debug"; returns false on a bad spec */
+    static bool setLevels(const QString& spec);
+
+    /* console messages per second and page, 0 for no limit */
+    static void setConsoleRate(int rate) {
+        s_consoleRate = rate;
+    }
+
+    static int consoleRate() {
+        return s_consoleRate;
+    }
+
+    /* monotonic clock in milliseconds */
+    static qint64 now();
+
+    /* Write JSON lines to path from now on. Once it grows beyond
+     * maxBytes it is renamed to path.1 (path.1 to path.2 and so on,
+     * keeping up to keep old files) and a new one is started. */
+    bool open(const QString& path, qint64 maxBytes, int keep);
+
+    const QString& errorString() const {
+        return m_errorString;
+    }
+
+    /* page: the URL the record is about, if any */
+    void log(int category, int level, const QString& message,
+             const QString& page = QString());
+
+    /* write out what is queued and stop the writer; nothing is
+     * logged after this */
+    void close();
+
+private:
+    Logger();
+
+    struct Record {
+        Record* next;
+        qint64 time;
+        int category;
+        int level;
+        QString message;
+        QString page;
+    };
+
+    friend class LogWriter;
+
+    /* called by the writer thread */
+    void drain();
+    void write(const Record* record);
+    void rotate();
+
+    static int s_levels[CategoryCount];
+    static int s_consoleRate;
+
+    QAtomicPointer<Record> m_head;
+    QAtomicInt m_queued;
+    QAtomicInt m_dropped;
+
+    /* guards the sink; never taken by log() */
+    QMutex m_mutex;
+    QWaitCondition m_wake;
+    bool m_stopping;
+    QThread* m_writer;
+
+    QFile m_file;
+    qint64 m_maxBytes;
+    int m_keep;
+    QString m_errorString;
+};
+
+/* Lets through at most Logger::consoleRate() messages a second. */
+class LogRateLimiter {
+public:
+    LogRateLimiter() : m_windowStart(0), m_count(0), m_dropped(0) {}
+
+    bool allow();
+
+    /* messages refused since the last call */
+    int takeDropped() {
+        int dropped = m_dropped;
+        m_dropped = 0;
+        return dropped;
+    }
+
+private:
+    qint64 m_windowStart;
+    int m_count;
+    int m_dropped;
+};
+
+#define VDOM_LOG(category, level, message) \
+    do { \
+        if (Logger::isEnabled(Logger::category, Logger::level)) \
+            Logger::instance()->log(Logger::category, Logger::level, (message)); \
+    } while (0)
+
+#endif // LOGGER_H
@@ -2,6 +2,18 @@
 #include "webpage.h"
 #include "mainwindow.h"
 #include "urlloader.h"
+#include "batchcrawler.h"
+#include "coordinator.h"
+#include "networkaccessmanager.h"
+#include "requestfilter.h"
+#include "tracer.h"
+#include "logger.h"
+#include "memorygovernor.h"
+#include "readinessmonitor.h"
+#include "vdombinary.h"
+#include "virtualdisplay.h"
+#include "processpool.h"
+#include "hunterresultcache.h"
 
 #include <qwebview.h>
 #include <qwebframe.h>
@@ -15,17 +27,39 @@
 #include <QTextStream>
 #include <QFile>
 #include <cstdio>
+#include <cstring>
 
 static void help(int status_code);
 static void showVersion(const QApplication& app);
+static QString optionValue(const QStringList& args, int& i);
+static bool hasOption(int argc, char** argv, const char* name);
+
+/* the --ready-timeout of batch pages, unless given */
+const static int BATCH_READY_TIMEOUT = 60000;
 
 int main(int argc, char **argv)
 {
+    /* these have to be settled before the QApplication connects to
+     * a display */
+    VirtualDisplay xvfb;
+    if (hasOption(argc, argv, "--xvfb")) {
+        QString errorString;
+        if (!xvfb.start(errorString)) {
+            fprintf(stderr, "%s\n", errorString.toUtf8().data());
+            return 1;
+        }
+    }
+#if QT_VERSION >= 0x050000 || defined(Q_WS_QPA)
+    else if ((hasOption(argc, argv, "--batch") || hasOption(argc, argv, "--worker") ||
+                hasOption(argc, argv, "--workers")) &&
+            qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+        /* nothing is shown, so no window system is needed */
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+#endif
     QApplication app(argc, argv);
     QString url = "http://www.yahoo.cn";
 
-    QWebSettings::setMaximumPagesInCache(20);
-
     app.setApplicationName(VB_PRODUCT_NAME);
     app.setApplicationVersion(
         QString("%1.%2.%3")
@@ -37,21 +71,216 @@ int main(int argc, char **argv)
     QCoreApplication::setOrganizationDomain("eeeeworks.org");
     QCoreApplication::setApplicationName(VB_PRODUCT_NAME);
 
-    QWebSettings::setObjectCacheCapacities((16*1024*1024) / 8, (16*1024*1024) / 8, 16*1024*1024);
+    /* sets up the WebKit cache capacities */
+    MemoryGovernor::instance();
 
     QWebSettings::globalSettings()->setAttribute(QWebSettings::DeveloperExtrasEnabled, true);
 
     const QStringList args = app.arguments();
     QStringList jsFiles;
+    QStringList earlyJSFiles;
+    QString batchFile;
+    QString outDir = ".";
+    int jobs = 1;
+    QString recordDir;
+    QString replayDir;
+    int replayLatency = 0;
+    QString traceFile;
+    QString logFile;
+    int logSize = 64;
+    int logFiles = 5;
+    QString filterFile;
+    int dumpFormat = VdomBinary::TextDump;
+    QString captureFormat;
+    bool deltaDumps = false;
+    int workers = 0;
+    bool worker = false;
+    QString workerId;
+    QString queue;
+    int listenPort = 0;
+    int memoryBudget = 0;
+    int readyPolicy = ReadinessMonitor::LoadFinished;
+    int readyIdle = 500;
+    /* -1: the default of the mode */
+    int readyTimeout = -1;
+    QSize viewport(1024, 768);
+    int recyclePages = 0;
+    /* what the workers of a coordinator get passed on */
+    QStringList workerArgs;
 
     for (int i = 1; i < args.count(); i++) {
         QString arg = args.at(i);
+        int first = i;
+        bool forward = true;
         if (arg == "-h" || arg == "--help") {
             //argHelp = true;
             help(0);
         } else if (arg.indexOf("--js=") == 0) {
             QString jsFile = arg.split("=").at(1);
             jsFiles.push_back(jsFile);
+        } else if (arg.indexOf("--early-js=") == 0) {
+            earlyJSFiles.push_back(arg.split("=").at(1));
+        } else if (arg == "--batch" || arg.indexOf("--batch=") == 0) {
+            batchFile = optionValue(args, i);
+            forward = false;
+        } else if (arg == "--workers" || arg.indexOf("--workers=") == 0) {
+            bool ok;
+            workers = optionValue(args, i).toInt(&ok);
+            if (!ok || workers < 1) {
+                fprintf(stderr, "Invalid --workers value.\n\n");
+                exit(1);
+            }
+            forward = false;
+        } else if (arg == "--queue" || arg.indexOf("--queue=") == 0) {
+            queue = optionValue(args, i);
+            forward = false;
+        } else if (arg == "--listen" || arg.indexOf("--listen=") == 0) {
+            bool ok;
+            listenPort = optionValue(args, i).toInt(&ok);
+            if (!ok || listenPort < 1 || listenPort > 65535) {
+                fprintf(stderr, "Invalid --listen value.\n\n");
+                exit(1);
+            }
+            forward = false;
+        } else if (arg == "--worker") {
+            worker = true;
+            forward = false;
+        } else if (arg == "--worker-id" || arg.indexOf("--worker-id=") == 0) {
+            workerId = optionValue(args, i);
+            forward = false;
+        } else if (arg == "--jobs" || arg.indexOf("--jobs=") == 0) {
+            bool ok;
+            jobs = optionValue(args, i).toInt(&ok);
+            if (!ok || jobs < 1) {
+                fprintf(stderr, "Invalid --jobs value.\n\n");
+                exit(1);
+            }
+        } else if (arg == "--out" || arg.indexOf("--out=") == 0) {
+            outDir = optionValue(args, i);
+        } else if (arg == "--dump-format" || arg.indexOf("--dump-format=") == 0) {
+            QString format = optionValue(args, i);
+            if (format == "text") {
+                dumpFormat = VdomBinary::TextDump;
+            } else if (format == "binary") {
+                dumpFormat = VdomBinary::BinaryDump;
+            } else if (format == "binary-z") {
+                dumpFormat = VdomBinary::CompressedBinaryDump;
+            } else {
+                fprintf(stderr, "Invalid --dump-format value.\n\n");
+                exit(1);
+            }
+        } else if (arg == "--capture" || arg.indexOf("--capture=") == 0) {
+            captureFormat = optionValue(args, i);
+            if (captureFormat != "png" && captureFormat != "jpg") {
+                fprintf(stderr, "Invalid --capture value.\n\n");
+                exit(1);
+            }
+        } else if (arg == "--hunter-cache" || arg.indexOf("--hunter-cache=") == 0) {
+            HunterResultCache::setDefaultDirectory(optionValue(args, i));
+        } else if (arg == "--delta") {
+            deltaDumps = true;
+        } else if (arg == "--ready" || arg.indexOf("--ready=") == 0) {
+            if (!ReadinessMonitor::parsePolicy(optionValue(args, i), readyPolicy)) {
+                fprintf(stderr, "Invalid --ready value.\n\n");
+                exit(1);
+            }
+        } else if (arg == "--ready-idle" || arg.indexOf("--ready-idle=") == 0) {
+            bool ok;
+            readyIdle = optionValue(args, i).toInt(&ok);
+            if (!ok || readyIdle < 0) {
+                fprintf(stderr, "Invalid --ready-idle value.\n\n");
+                exit(1);
+            }
+        } else if (arg == "--ready-timeout" || arg.indexOf("--ready-timeout=") == 0) {
+            bool ok;
+            readyTimeout = optionValue(args, i).toInt(&ok);
+            if (!ok || readyTimeout < 0) {
+                fprintf(stderr, "Invalid --ready-timeout value.\n\n");
+                exit(1);
+            }
+        } else if (arg == "--viewport" || arg.indexOf("--viewport=") == 0) {
+            QStringList size = optionValue(args, i).split('x');
+            bool ok1 = false, ok2 = false;
+            if (size.count() == 2) {
+                viewport = QSize(size[0].toInt(&ok1), size[1].toInt(&ok2));
+            }
+            if (!ok1 || !ok2 || viewport.isEmpty()) {
+                fprintf(stderr, "Invalid --viewport value.\n\n");
+                exit(1);
+            }
+        } else if (arg == "--max-processes" || arg.indexOf("--max-processes=") == 0) {
+            bool ok;
+            int limit = optionValue(args, i).toInt(&ok);
+            if (!ok || limit < 1) {
+                fprintf(stderr, "Invalid --max-processes value.\n\n");
+                exit(1);
+            }
+            ProcessPool::setDefaultLimit(limit);
+        } else if (arg == "--xvfb") {
+            /* started above; the workers of a coordinator share it */
+            forward = false;
+        } else if (arg == "--memory-budget" || arg.indexOf("--memory-budget=") == 0) {
+            bool ok;
+            memoryBudget = optionValue(args, i).toInt(&ok);
+            if (!ok || memoryBudget < 0) {
+                fprintf(stderr, "Invalid --memory-budget value.\n\n");
+                exit(1);
+            }
+        } else if (arg == "--recycle-pages" || arg.indexOf("--recycle-pages=") == 0) {
+            bool ok;
+            recyclePages = optionValue(args, i).toInt(&ok);
+            if (!ok || recyclePages < 0) {
+                fprintf(stderr, "Invalid --recycle-pages value.\n\n");
+                exit(1);
+            }
+        } else if (arg == "--filter" || arg.indexOf("--filter=") == 0) {
+            filterFile = optionValue(args, i);
+        } else if (arg == "--trace" || arg.indexOf("--trace=") == 0) {
+            traceFile = optionValue(args, i);
+            /* one file per worker, see below */
+            forward = false;
+        } else if (arg == "--log" || arg.indexOf("--log=") == 0) {
+            logFile = optionValue(args, i);
+            /* one file per worker, like --trace */
+            forward = false;
+        } else if (arg == "--log-level" || arg.indexOf("--log-level=") == 0) {
+            if (!Logger::setLevels(optionValue(args, i))) {
+                fprintf(stderr, "Invalid --log-level value.\n\n");
+                exit(1);
+            }
+        } else if (arg == "--log-size" || arg.indexOf("--log-size=") == 0) {
+            bool ok;
+            logSize = optionValue(args, i).toInt(&ok);
+            if (!ok || logSize < 1) {
+                fprintf(stderr, "Invalid --log-size value.\n\n");
+                exit(1);
+            }
+        } else if (arg == "--log-files" || arg.indexOf("--log-files=") == 0) {
+            bool ok;
+            logFiles = optionValue(args, i).toInt(&ok);
+            if (!ok || logFiles < 0) {
+                fprintf(stderr, "Invalid --log-files value.\n\n");
+                exit(1);
+            }
+        } else if (arg == "--console-rate" || arg.indexOf("--console-rate=") == 0) {
+            bool ok;
+            int rate = optionValue(args, i).toInt(&ok);
+            if (!ok || rate < 0) {
+                fprintf(stderr, "Invalid --console-rate value.\n\n");
+                exit(1);
+            }
+            Logger::setConsoleRate(rate);
+        } else if (arg == "--record" || arg.indexOf("--record=") == 0) {
+            recordDir = optionValue(args, i);
+        } else if (arg == "--replay" || arg.indexOf("--replay=") == 0) {
+            replayDir = optionValue(args, i);
+        } else if (arg == "--replay-latency" || arg.indexOf("--replay-latency=") == 0) {
+            bool ok;
+            replayLatency = optionValue(args, i).toInt(&ok);
+            if (!ok || replayLatency < 0) {
+                fprintf(stderr, "Invalid --replay-latency value.\n\n");
+                exit(1);
+            }
         } else if (arg == "-v" || arg == "--version") {
             showVersion(app);
             return 0;
@@ -61,15 +290,140 @@ int main(int argc, char **argv)
         } else {
             url = arg;
         }
+        if (forward) {
+            workerArgs += args.mid(first, i - first + 1);
+        }
+    }
+
+    if (worker && !workerId.isEmpty() && !logFile.isEmpty()) {
+        logFile += "." + workerId;
+    }
+    /* set up before any other thread may log */
+    Logger* logger = Logger::instance();
+    if (!logFile.isEmpty() && !logger->open(logFile, qint64(logSize) << 20, logFiles)) {
+        fprintf(stderr, "%s\n", logger->errorString().toUtf8().data());
+        exit(1);
+    }
+
+    if (workers > 0) {
+        /* coordinator mode: no browsing here, just supervision */
+        if (queue.isEmpty()) {
+            if (batchFile.isEmpty()) {
+                fprintf(stderr, "--workers needs --batch or --queue.\n\n");
+                exit(1);
+            }
+            queue = outDir + "/queue";
+        }
+        if (!traceFile.isEmpty()) {
+            workerArgs << "--trace" << traceFile;
+        }
+        if (!logFile.isEmpty()) {
+            workerArgs << "--log" << logFile;
+        }
+        Coordinator coordinator(workers, queue, workerArgs);
+        coordinator.setListFile(batchFile);
+        coordinator.setListenPort(listenPort);
+        QObject::connect(&coordinator, SIGNAL(finished()), &app, SLOT(quit()));
+        if (!coordinator.start()) {
+            return 1;
+        }
+        int ret = app.exec();
+        logger->close();
+        return ret;
+    }
+    if (worker && queue.isEmpty()) {
+        fprintf(stderr, "--worker needs --queue.\n\n");
+        exit(1);
+    }
+    if (worker && !workerId.isEmpty() && !traceFile.isEmpty()) {
+        /* the workers of one coordinator share the --trace option */
+        traceFile += "." + workerId;
     }
 
-    MainWindow window(url);
-    //qDebug() << "js files: " << jsFiles << endl;
-    if (jsFiles.count() > 0) {
-        window.setJSFiles(jsFiles);
+    if (readyTimeout < 0) {
+        /* a page which never finishes must not stall its batch job */
+        readyTimeout = worker || !batchFile.isEmpty() ? BATCH_READY_TIMEOUT : 0;
     }
-    window.show();
-    return app.exec();
+    ReadinessMonitor::setDefaults(readyPolicy, readyIdle, readyTimeout);
+    MemoryGovernor::instance()->setBudget(memoryBudget);
+    MemoryGovernor::instance()->setRecyclePages(recyclePages);
+
+    if (!recordDir.isEmpty() && !replayDir.isEmpty()) {
+        fprintf(stderr, "--record and --replay are mutually exclusive.\n\n");
+        exit(1);
+    }
+    if (!recordDir.isEmpty() || !replayDir.isEmpty()) {
+        QString errorString;
+        bool ok = recordDir.isEmpty()
+            ? NetworkAccessManager::setArchive(NetworkAccessManager::ReplayArchive,
+                    replayDir, errorString)
+            : NetworkAccessManager::setArchive(NetworkAccessManager::RecordArchive,
+                    recordDir, errorString);
+        if (!ok) {
+            fprintf(stderr, "%s\n", errorString.toUtf8().data());
+            exit(1);
+        }
+        NetworkAccessManager::setReplayLatency(replayLatency);
+    }
+    if (!filterFile.isEmpty() && !RequestFilter::instance()->load(filterFile)) {
+        fprintf(stderr, "%s\n", RequestFilter::instance()->errorString().toUtf8().data());
+        exit(1);
+    }
+
+    if (!traceFile.isEmpty() && !Tracer::instance()->open(traceFile)) {
+        fprintf(stderr, "%s\n", Tracer::instance()->errorString().toUtf8().data());
+        exit(1);
+    }
+
+    int ret;
+    if (worker) {
+        WorkQueue* workQueue = Coordinator::isRemoteQueue(queue)
+            ? static_cast<WorkQueue*>(new RemoteWorkQueue(queue.mid(6)))
+            : static_cast<WorkQueue*>(new FileWorkQueue(queue, workerId));
+        BatchCrawler crawler(workQueue, jobs, outDir);
+        crawler.setJSFiles(jsFiles);
+        crawler.setEarlyJSFiles(earlyJSFiles);
+        crawler.setDumpFormat(dumpFormat);
+        crawler.setCaptureFormat(captureFormat);
+        crawler.setViewportSize(viewport);
+        QObject::connect(&crawler, SIGNAL(finished()), &app, SLOT(quit()));
+        if (!crawler.start()) {
+            return 1;
+        }
+        ret = app.exec();
+        /* lost the queue: let the coordinator know this was no clean
+         * finish */
+        if (ret == 0 && !workQueue->isValid()) {
+            ret = 1;
+        }
+    } else if (!batchFile.isEmpty()) {
+        BatchCrawler crawler(batchFile, jobs, outDir);
+        crawler.setJSFiles(jsFiles);
+        crawler.setEarlyJSFiles(earlyJSFiles);
+        crawler.setDumpFormat(dumpFormat);
+        crawler.setCaptureFormat(captureFormat);
+        crawler.setViewportSize(viewport);
+        QObject::connect(&crawler, SIGNAL(finished()), &app, SLOT(quit()));
+        if (!crawler.start()) {
+            return 1;
+        }
+        ret = app.exec();
+    } else {
+        MainWindow window(url);
+        //qDebug() << "js files: " << jsFiles << endl;
+        if (jsFiles.count() > 0) {
+            window.setJSFiles(jsFiles);
+        }
+        window.setEarlyJSFiles(earlyJSFiles);
+        window.setDeltaDumps(deltaDumps);
+        window.show();
+        ret = app.exec();
+    }
+    /* terminates the JSON array of the trace */
+    Tracer::instance()->close();
+    /* writes out what is still queued */
+    logger->close();
+    return ret;
 }
 
 static void help(int status_code) {
@@ -81,12 +435,134 @@ static void help(int status_code) {
         "  --js <.js file>  JavaScript file executed after loading each web\n"
         "                   page. Multiple --js are allowed and would run\n"
         "                   in order.\n"
+        "  --early-js <.js file>\n"
+        "                   Like --js, but injected as soon as the window\n"
+        "                   object of a page is created, before any script\n"
+        "                   of the page itself runs.\n"
+        "  --batch <file>   Headless batch mode: dump the VDOM of every URL\n"
+        "                   listed in <file> without opening any window.\n"
+        "  --jobs <N>       Number of pages loaded in parallel in batch\n"
+        "                   mode. (Default: 1)\n"
+        "  --out <dir>      Directory receiving the <index>.vdom files in\n"
+        "                   batch mode. (Default: .)\n"
+        "  --dump-format <text|binary|binary-z>\n"
+        "                   Write the batch dumps as text, or in the compact\n"
+        "                   binary format (see vdombinary.h) as <index>.vdb,\n"
+        "                   optionally compressed. (Default: text)\n"
+        "  --capture <png|jpg>\n"
+        "                   Also save an image of every batch page, in tiles\n"
+        "                   of at most 2048 rows named <index>.<n>.<format>.\n"
+        "  --hunter-cache <dir|off>\n"
+        "                   Keep the hunter results by dump, hunter and\n"
+        "                   hunter mtime in <dir>, and serve a dump hunted\n"
+        "                   before from there without running the hunter.\n"
+        "                   (Default: the cache location of the user)\n"
+        "  --delta          When hunting the page shown again, pass the hunter\n"
+        "                   only the lines that changed since the dump file\n"
+        "                   it already has, as --delta <dump>.delta (file\n"
+        "                   transport only; see dumpdelta.h). Hunt Only\n"
+        "                   always takes a whole new dump; only writing a\n"
+        "                   dump identical to the file is skipped.\n"
+        "  --ready <load|dom|network-idle|quiet>\n"
+        "                   When a page is ready to be dumped: on load\n"
+        "                   finished, on DOMContentLoaded, or after that\n"
+        "                   once no request ran (network-idle) or no node\n"
+        "                   or text changed in any frame (quiet; attribute\n"
+        "                   and style changes do not count) for --ready-idle\n"
+        "                   ms, if the load does not finish first.\n"
+        "                   (Default: load)\n"
+        "  --ready-idle <ms>\n"
+        "                   (Default: 500)\n"
+        "  --ready-timeout <ms>\n"
+        "                   Stop pages loading longer than <ms> and dump\n"
+        "                   them as they are; 0 for no timeout. (Default:\n"
+        "                   60000 for batch pages, no timeout otherwise)\n"
+        "  --memory-budget <MB>\n"
+        "                   Shrink the WebKit caches as the resident size\n"
+        "                   of the process nears <MB>, and rebuild batch\n"
+        "                   pages when it gets close. (Default: no budget)\n"
+        "  --recycle-pages <N>\n"
+        "                   Rebuild every batch page after <N> pages.\n"
+        "                   (Default: never)\n"
+        "  --max-processes <N>\n"
+        "                   Run at most <N> helper programs started by page\n"
+        "                   scripts at a time. (Default: one per CPU core)\n"
+        "  --viewport <W>x<H>\n"
+        "                   Lay batch pages out for a <W>x<H> window.\n"
+        "                   (Default: 1024x768)\n"
+        "  --xvfb           Run on a private Xvfb display instead of $DISPLAY,\n"
+        "                   for hosts without an X server.\n"
+        "  --workers <N>    Coordinator mode: run <N> batch worker processes\n"
+        "                   sharing one work queue, restarting those that\n"
+        "                   crash and requeueing their URLs. Takes --batch\n"
+        "                   (or resumes --queue) and passes the other batch\n"
+        "                   options on to the workers.\n"
+        "  --queue <dir|tcp://host:port>\n"
+        "                   The work queue: a directory shared by the\n"
+        "                   processes of this host (Default: <out>/queue),\n"
+        "                   or the broker of a coordinator run with --listen\n"
+        "                   on another host.\n"
+        "  --listen <port>  Serve the queue directory of this coordinator to\n"
+        "                   workers on other hosts.\n"
+        "  --worker         Batch mode taking URLs from --queue; this is what\n"
+        "                   the coordinator runs.\n"
+        "  --record <dir>   Store every response in the web archive <dir>\n"
+        "                   while browsing.\n"
+        "  --replay <dir>   Serve all http(s) requests from the web archive\n"
+        "                   <dir> recorded by --record, never touching the\n"
+        "                   network.\n"
+        "  --replay-latency <ms>\n"
+        "                   Delay every replayed response by <ms>.\n"
+        "  --filter <file>  Block requests by URL pattern, resource type and\n"
+        "                   third-party origin, and cap the requests and\n"
+        "                   bytes of every page, by the rules in <file>.\n"
+        "  --log <file>     Write the log as JSON lines to <file> instead of\n"
+        "                   as text to stderr.\n"
+        "  --log-level <level|category=level,...>\n"
+        "                   debug, info, warning, error or off, for all or\n"
+        "                   some of the categories general, console,\n"
+        "                   network, hunter, batch and bridge.\n"
+        "                   (Default: info)\n"
+        "  --log-size <MB>  Rotate the --log file at <MB>. (Default: 64)\n"
+        "  --log-files <N>  Keep <N> rotated log files. (Default: 5)\n"
+        "  --console-rate <N>\n"
+        "                   Log at most <N> JavaScript console messages a\n"
+        "                   second per page, 0 for no limit. (Default: 50)\n"
+        "  --trace <file>   Write a Chrome trace-event timeline of the phases\n"
+        "                   of every page (load, inject, dump, hunt, ...) to\n"
+        "                   <file> and a summary line per page to stderr.\n"
         "  -v\n"
         "  --version        Display version number.\n"
     );
     exit(status_code);
 }
 
+/* Accept both "--opt value" and "--opt=value" */
+static QString optionValue(const QStringList& args, int& i) {
+    const QString& arg = args.at(i);
+    int eq = arg.indexOf("=");
+    if (eq >= 0) {
+        return arg.mid(eq + 1);
+    }
+    if (i + 1 >= args.count()) {
+        fprintf(stderr, "Option %s requires a value.\n\n", arg.toUtf8().data());
+        help(1);
+    }
+    return args.at(++i);
+}
+
+/* For the few options that matter before the QApplication exists */
+static bool hasOption(int argc, char** argv, const char* name) {
+    size_t len = strlen(name);
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], name, len) == 0 &&
+                (argv[i][len] == '\0' || argv[i][len] == '=')) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static void showVersion (const QApplication& app) {
     std::cout << QString("VdomBrowser version %1\n"
         "Copyright (c) 2009 by Yahoo! China EEEE Works, Alibaba Inc.\n"
@@ -1,11 +1,127 @@
 #include "mainwindow.h"
 #include "webpage.h"
 #include "webview.h"
+#include "jsonwriter.h"
+#include "scriptcache.h"
+#include "tracer.h"
+#include "memorygovernor.h"
+#include "dumpdelta.h"
 #include <stdlib.h>
 
-const static int MAX_FILE_LINE_LEN = 2048;
-
-MainWindow::MainWindow(const QString& url): currentZoom(100) {
+/* The page-side half of annotateGroups(). All boxes live in one
+ * layer div which handles hovering by event delegation; the boxes of
+ * each group are looked up in a map instead of the DOM, and box nodes
+ * are recycled between hunts. */
+const static char ANNOTATION_LIB[] =
+    "window._vdom_annotate = (function () {"
+      "var layer = null, boxes = [], used = 0, groups = {}, selected = null;"
+      "function ensureLayer() {"
+        "if (layer && layer.parentNode) return;"
+        "layer = document.createElement('div');"
+        "layer.style.position = 'absolute';"
+        "layer.style.left = '0px';"
+        "layer.style.top = '0px';"
+        "layer.addEventListener('mouseover', function (e) {"
+          "var box = e.target;"
+          "if (selected || !box._vdom_hl) return;"
+          "itemInfoEdit.plainText = box._vdom_desc;"
+          "statusBar.showMessage(box._vdom_title);"
+          "highlight(box._vdom_group, true);"
+        "}, true);"
+        "layer.addEventListener('mouseout', function (e) {"
+          "var box = e.target;"
+          "if (selected || !box._vdom_hl) return;"
+          "highlight(box._vdom_group, false);"
+        "}, true);"
+        "document.body.appendChild(layer);"
+        "boxes = []; used = 0;"
+      "}"
+      "function highlight(group, on) {"
+        "var nodes = groups[group];"
+        "if (!nodes) return;"
+        "for (var i = 0; i < nodes.length; i++) {"
+          "var style = nodes[i].style;"
+          "if (on) {"
+            "nodes[i]._vdom_color = style.borderColor;"
+            "style.borderColor = 'yellow';"
+          "} else if (nodes[i]._vdom_color != null) {"
+            "style.borderColor = nodes[i]._vdom_color;"
+          "}"
+        "}"
+      "}"
+      "window.addEventListener('mousedown', function (e) {"
+        "if (selected || !e.target || !e.target._vdom_hl) return;"
+        "selected = e.target;"
+      "}, true);"
+      "window.addEventListener('keydown', function (e) {"
+        "if (e.keyCode == 27 && selected) {"
+          "var box = selected;"
+          "selected = null;"
+          "highlight(box._vdom_group, false);"
+        "}"
+      "}, true);"
+      "function opt(v, def) { return v == null ? def : v; }"
+      "return {"
+        "begin: function () {"
+          "ensureLayer();"
+          "used = 0; groups = {}; selected = null;"
+        "},"
+        "add: function (list, offset) {"
+          "ensureLayer();"
+          "for (var g = 0; g < list.length; g++) {"
+            "var group = list[g];"
+            "if (!(group instanceof Array)) continue;"
+            "var id = g + offset;"
+            "var nodes = groups[id] || (groups[id] = []);"
+            "for (var j = 0; j < group.length; j++) {"
+              "var it = group[j];"
+              "if (!it || typeof it != 'object') continue;"
+              "var box = boxes[used];"
+              "if (!box) {"
+                "box = boxes[used] = document.createElement('div');"
+                "layer.appendChild(box);"
+              "}"
+              "used++;"
+              "var style = box.style;"
+              "style.borderWidth = opt(it.borderWidth, 2) + 'px';"
+              "style.borderColor = opt(it.borderColor, 'red');"
+              "style.borderStyle = opt(it.borderStyle, 'solid');"
+              "style.position = 'absolute';"
+              "style.left   = (it.x | 0) + 'px';"
+              "style.top    = (it.y | 0) + 'px';"
+              "style.width  = (it.w | 0) + 'px';"
+              "style.height = (it.h | 0) + 'px';"
+              "style.display = '';"
+              "box.className = 'vdom-result vdom-group-' + id;"
+              "box._vdom_group = id;"
+              "box._vdom_color = null;"
+              "box._vdom_hl = !it.noHighlight;"
+              "box._vdom_desc = String(opt(it.desc, ''));"
+              "box._vdom_title = String(opt(it.title, ''));"
+              "nodes.push(box);"
+            "}"
+          "}"
+        "},"
+        "end: function () {"
+          "while (boxes.length > used) {"
+            "var box = boxes.pop();"
+            "if (box.parentNode) box.parentNode.removeChild(box);"
+          "}"
+        "},"
+        "show: function (on) {"
+          "if (layer) layer.style.display = on ? '' : 'none';"
+        "}"
+      "};"
+    "})();";
+
+MainWindow::MainWindow(const QString& url):
+    currentZoom(100), m_hunterResultReady(false), m_hunterJobId(-1),
+    m_resultParseId(0), m_annotating(false),
+    m_deltaDumps(false), m_dumpJob(-1), m_writeStart(0),
+    m_fileDumpFormat(-1), m_fileDumpSize(-1),
+    m_tracePage(-1),
+    m_loadStart(0), m_huntStart(0), m_parseStart(0)
+{
     m_iterLabel = new QLabel(this);
 
     QDesktopServices::setUrlHandler(QLatin1String("http"), this, "loadUrl");
@@ -21,6 +137,40 @@ MainWindow::MainWindow(const QString& url): currentZoom(100) {
             this, SLOT(hunterFinished(int, QProcess::ExitStatus)));
     connect(&m_hunter, SIGNAL(started()), this, SLOT(hunterStarted()));
 
+    m_hunterPool = new HunterPool(this);
+    connect(m_hunterPool, SIGNAL(started()), this, SLOT(hunterStarted()));
+    connect(m_hunterPool, SIGNAL(resultReady(int, const QByteArray&)),
+            this, SLOT(hunterPoolResult(int, const QByteArray&)));
+    connect(m_hunterPool, SIGNAL(failed(int, const QString&)),
+            this, SLOT(hunterPoolFailed(int, const QString&)));
+    connect(m_hunterPool, SIGNAL(stderrReceived(const QString&)),
+            this, SLOT(emitHunterPoolStderr(const QString&)));
+
+    m_parserThread = new QThread(this);
+    m_resultParser = new HunterResultParser;
+    m_resultParser->moveToThread(m_parserThread);
+    connect(m_resultParser, SIGNAL(groupsParsed(int, int, const QVariantList&)),
+            this, SLOT(hunterGroupsParsed(int, int, const QVariantList&)));
+    connect(m_resultParser, SIGNAL(finished(int, const QVariantMap&)),
+            this, SLOT(hunterResultParsed(int, const QVariantMap&)));
+    connect(m_resultParser, SIGNAL(failed(int, const QString&)),
+            this, SLOT(hunterResultFailed(int, const QString&)));
+    m_parserThread->start();
+
+    m_dumpPipeline = new DumpPipeline(this);
+    connect(m_dumpPipeline, SIGNAL(finished(int, const QByteArray&, const QByteArray&, const QString&)),
+            this, SLOT(dumpWritten(int, const QByteArray&, const QByteArray&, const QString&)));
+
+    m_fileBridge = new FileBridge(this);
+
+    m_processPool = new ProcessPool(this);
+    connect(m_processPool, SIGNAL(finished(int, int, const QString&)),
+            this, SLOT(processFinished(int, int, const QString&)));
+
+    m_capture = new PageCapture(this);
+    connect(m_capture, SIGNAL(tileWritten(const QString&, const QString&)),
+            this, SLOT(imageTileWritten(const QString&, const QString&)));
+
     m_huntButton = new QPushButton(tr("Hun&t"), this);
     connect(m_huntButton, SIGNAL(clicked()), SLOT(huntOnly()));
 
@@ -33,6 +183,16 @@ MainWindow::MainWindow(const QString& url): currentZoom(100) {
     m_iterNextButton = new QPushButton(tr("&Next"), this);
     connect(m_iterNextButton, SIGNAL(clicked()), SLOT(iterNext()));
 
+    m_iterUrls = new UrlList(this);
+    connect(m_iterUrls, SIGNAL(countChanged(int)), SLOT(iterListGrown(int)));
+    connect(m_iterUrls, SIGNAL(completed(int)), SLOT(iterListGrown(int)));
+
+    m_prefetcher = new PagePrefetcher(this);
+    connect(m_prefetcher, SIGNAL(pageCreated(WebPage*)),
+            this, SLOT(preparePage(WebPage*)));
+    connect(m_prefetcher, SIGNAL(pageLoaded(WebPage*)),
+            this, SLOT(prefetchedPageLoaded(WebPage*)));
+
     m_settings = new QSettings(
         QSettings::UserScope,
         qApp->organizationDomain(),
@@ -42,13 +202,6 @@ MainWindow::MainWindow(const QString& url): currentZoom(100) {
     readSettings();
 
     setupUI();
-    m_callProc = new QProcess();
-
-    connect(m_view->page()->mainFrame(), SIGNAL(javaScriptWindowObjectCleared()),
-            this, SLOT(populateJavaScriptWindowObject()));
-
-    connect(m_callProc, SIGNAL(finished(int, QProcess::ExitStatus)),
-            this, SLOT(processFinished(int, QProcess::ExitStatus)));
 
     QUrl qurl;
     qurl.setEncodedUrl(url.toUtf8(), QUrl::StrictMode);
@@ -63,6 +216,14 @@ MainWindow::MainWindow(const QString& url): currentZoom(100) {
     }
 }
 
+MainWindow::~MainWindow() {
+    Tracer::instance()->endPage(m_tracePage, "closed");
+    m_resultParser->supersede(-1);
+    m_parserThread->quit();
+    m_parserThread->wait();
+    delete m_resultParser;
+}
+
 void MainWindow::changeLocation() {
     //QUrl url = guessUrlFromString(urlEdit->text());
     //
@@ -84,74 +245,206 @@ void MainWindow::changeLocation() {
 }
 
 void MainWindow::loadFinished(bool done) {
+    if (Tracer::isEnabled()) {
+        Tracer::instance()->span(m_tracePage, "load", m_loadStart, Tracer::now());
+        Tracer::instance()->setPageUrl(m_tracePage,
+                QString::fromUtf8(m_view->url().toEncoded()));
+        Tracer::instance()->instant(m_tracePage, webPage()->readiness()->condition());
+    }
     if (!done) {
         statusBar()->showMessage(
             QString("Failed to open resource %1.")
                 .arg(m_urlEdit->text().trimmed()));
+        traceEndPage("failed");
         return;
     }
     //qDebug() << "Loaded URL " << m_view->url().toEncoded() << "." << endl;
     m_urlEdit->setText(m_view->url().toEncoded());
     addUrlToList();
 
-    if (!m_injectedJSFiles.isEmpty()) {
-        for (int i = 0; i < m_injectedJSFiles.count(); i++) {
-            const QString& fileName = m_injectedJSFiles[i];
-            //qDebug() << QString("Checking if file %1 is readable...")
-                //.arg(fileName).toUtf8() << endl;
-            if (!QFile::exists(fileName)) {
-                qDebug() <<
-                    QString("js file \"%1\" not found.\n").arg(fileName).toUtf8().data();
-                continue;
-            }
-
-            QFile file(fileName);
-            if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                qDebug() <<
-                    QString("Failed to load js file %1: %2\n")
-                        .arg(fileName).arg(file.errorString()).toUtf8();
-                file.close();
-                continue;
-            }
-            qDebug() << "Loading JS file " << fileName << "...\n";
-            QString injectedJS = QString::fromUtf8(file.readAll()) + "\n";
-            QVariant res = evalJS(injectedJS + "true");
-            qDebug() << "injecting JS res: " << res << endl;
-        }
+    {
+        TraceScope scope(m_tracePage, "inject");
+        injectJS(m_view->page()->mainFrame(), m_injectedJSFiles);
     }
 
     if (m_hunterEnabled) {
-        /* dump VDOM to the external file */
-        const QByteArray& vdom = m_webvdom->dump();
-        //qDebug() << QString::fromUtf8(vdom);
-        QFile file(m_vdomPath);
-        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-            QMessageBox::warning(this, tr("VDOM Dumper"),
-                QString("Failed to open file ") +
-                m_vdomPath + " for writing: " +
-                file.errorString(), QMessageBox::NoButton);
-            return;
+        QByteArray vdom;
+        {
+            TraceScope scope(m_tracePage, "dump");
+            vdom = m_webvdom->dump();
         }
-        if (file.write(vdom) == -1) {
-            QMessageBox::warning(this, tr("VDOM Dumper"),
-                QString("Failed to write VDOM dump to file ") +
-                m_vdomPath + ": " +
-                file.errorString(), QMessageBox::NoButton);
-            file.close();
+        //qDebug() << QString::fromUtf8(vdom);
+        runHunter(vdom);
+    } else {
+        traceEndPage();
+    }
+    /* adapt the caches; the page shown keeps its history, so it is
+     * never rebuilt */
+    MemoryGovernor::instance()->pageDone(0);
+    /* the network is ours again, look ahead */
+    schedulePrefetch();
+}
+
+/* Get the dump to the hunter. The file transport's hunter is only
+ * started once its file is written: the file is left alone if it still
+ * holds this very dump, and when re-hunting with delta dumps on, only
+ * the changes against it are written, to <path>.delta. The other
+ * transports get the dump encoded by the pipeline. */
+void MainWindow::runHunter(const QByteArray& text, bool rehunt) {
+    /* whatever the last hunt finds belongs to the last page */
+    resetHunt();
+    m_hunterArgs.clear();
+    m_pendingFileDump.clear();
+    if (m_hunterTransport != HunterConfigDialog::FileTransport) {
+        /* the dump goes to the hunter's stdin instead */
+        m_hunterArgs << "-";
+        submitDump(text, QString());
+        return;
+    }
+
+    QFileInfo info(m_vdomPath);
+    bool intact = m_fileDumpPath == m_vdomPath &&
+        m_fileDumpFormat == m_hunterDumpFormat &&
+        info.exists() && info.size() == m_fileDumpSize &&
+        info.lastModified() == m_fileDumpTime;
+
+    m_hunterArgs << m_vdomPath;
+    if (intact && text == m_fileDump) {
+        m_dumpJob = -1;
+        startHunt(m_fileDumpHash, QByteArray());
+        return;
+    }
+    if (intact && rehunt && m_deltaDumps) {
+        QByteArray delta = DumpDelta::make(m_fileDump, text);
+        if (!delta.isNull()) {
+            QString deltaPath = m_vdomPath + ".delta";
+            m_hunterArgs << "--delta" << deltaPath;
+            submitDump(delta, deltaPath, text);
             return;
         }
-        file.close();
+    }
+
+    /* the file is in flux until the write is done */
+    m_fileDumpPath.clear();
+    m_pendingFileDump = text;
+    submitDump(text, m_vdomPath);
+}
+
+void MainWindow::submitDump(const QByteArray& text, const QString& path,
+                            const QByteArray& hashed) {
+    m_writeStart = Tracer::isEnabled() ? Tracer::now() : 0;
+    /* supersedes a dump still on its way, whose hunt is of no use */
+    /* the hash is only of use to the result cache */
+    m_dumpJob = m_dumpPipeline->submit(text, m_hunterDumpFormat, path,
+                                       m_resultCache.isEnabled(), hashed);
+}
 
-        /* execute the external hunter program */
-        m_hunter.close();
-        QStringList args;
-        args << m_vdomPath;
-        m_itemInfoEdit->clear();
-        m_pageInfoEdit->clear();
-        m_hunterLabel->hide();
-        statusBar()->showMessage("Starting " + m_hunterPath + "...");
-        m_hunter.start(m_hunterPath, args);
+void MainWindow::dumpWritten(int id, const QByteArray& data, const QByteArray& sha1,
+                             const QString& error) {
+    if (id != m_dumpJob) {
+        return;
+    }
+    m_dumpJob = -1;
+    if (Tracer::isEnabled()) {
+        /* wall time, queueing for the writer included */
+        Tracer::instance()->span(m_tracePage, "write", m_writeStart, Tracer::now());
+    }
+    if (!error.isEmpty()) {
+        m_pendingFileDump.clear();
+        traceEndPage("write failed");
+        reportError(tr("Failed to write the VDOM dump: %1").arg(error));
+        return;
     }
+    if (!m_pendingFileDump.isNull()) {
+        QFileInfo info(m_vdomPath);
+        m_fileDump = m_pendingFileDump;
+        m_fileDumpHash = sha1;
+        m_fileDumpPath = m_vdomPath;
+        m_fileDumpFormat = m_hunterDumpFormat;
+        m_fileDumpSize = info.size();
+        m_fileDumpTime = info.lastModified();
+        m_pendingFileDump.clear();
+    }
+    startHunt(sha1, m_hunterTransport != HunterConfigDialog::FileTransport
+            ? data : QByteArray());
+}
+
+/* Serve the result from the cache if this hunter has seen this very
+ * dump before, or else run it. */
+void MainWindow::startHunt(const QByteArray& dumpSha1, const QByteArray& vdom) {
+    QByteArray key = m_resultCache.key(dumpSha1, m_hunterPath);
+    QString cached = m_resultCache.lookup(key);
+    updateCacheLabel();
+    if (!cached.isEmpty()) {
+        Tracer::instance()->instant(m_tracePage, "cached");
+        statusBar()->showMessage("Using the cached result of " + m_hunterPath + ".");
+        parseHunterResultFile(cached);
+        return;
+    }
+    m_huntKey = key;
+    launchHunter(vdom);
+}
+
+void MainWindow::updateCacheLabel() {
+    if (!m_resultCache.isEnabled()) {
+        return;
+    }
+    m_cacheLabel->setText(tr("Hunter cache: %1 hits, %2 misses")
+            .arg(m_resultCache.hits()).arg(m_resultCache.misses()));
+    m_cacheLabel->show();
+}
+
+/* Start the hunter on a dump that is ready for it: written out for
+ * the file transport, vdom otherwise. */
+void MainWindow::launchHunter(const QByteArray& vdom) {
+    statusBar()->showMessage("Starting " + m_hunterPath + "...");
+    m_huntStart = Tracer::isEnabled() ? Tracer::now() : 0;
+    if (m_hunterTransport == HunterConfigDialog::PoolTransport) {
+        m_hunterJobId = m_hunterPool->submit(vdom);
+        return;
+    }
+    TraceScope scope(m_tracePage, "spawn");
+    m_hunter.start(m_hunterPath, m_hunterArgs);
+    if (m_hunterTransport == HunterConfigDialog::PipeTransport) {
+        /* QProcess buffers this until the child is up */
+        m_hunter.write(HunterFrame::encode(vdom));
+        m_hunter.closeWriteChannel();
+    }
+}
+
+/* Errors of the post-load pipeline must not stop the pages coming,
+ * so they go to the hunter log and the status bar rather than into a
+ * modal box. */
+void MainWindow::reportError(const QString& msg) {
+    m_hunterLog->append(msg);
+    statusBar()->showMessage(msg);
+}
+
+/* Forget everything about the previous hunt before a new one. */
+void MainWindow::resetHunt() {
+    /* nothing the old hunter leaves behind may be cached */
+    m_huntKey.clear();
+    /* close() kills a running hunter and reports it finished right
+     * away, which must neither end the trace of the page now shown nor
+     * report an error for it */
+    m_hunter.blockSignals(true);
+    m_hunter.close();
+    m_hunter.blockSignals(false);
+    m_hunterFrames.reset();
+    m_hunterResult.clear();
+    m_hunterResultReady = false;
+    /* a result for the previous page is of no use any more */
+    m_hunterPool->cancel(m_hunterJobId);
+    m_hunterJobId = -1;
+    /* batches still being parsed belong to the previous hunt */
+    m_resultParseId++;
+    m_resultParser->supersede(m_resultParseId);
+    m_annotating = false;
+    m_huntedGroups.clear();
+    m_itemInfoEdit->clear();
+    m_pageInfoEdit->clear();
+    startHunterLog();
+    m_hunterLabel->hide();
 }
 
 void MainWindow::setupUI() {
@@ -160,6 +453,7 @@ void MainWindow::setupUI() {
     createUrlEdit();
     createToolBar();
     createMenus();
+    installPageActions();
     //m_hunterConfig->hide();
 }
 
@@ -175,7 +469,8 @@ void MainWindow::createCentralWidget() {
 
     m_settings->beginGroup("MainWindow");
     //qDebug() << "splitter state fron settings: " << m_settings->value("sidebarSplitterSizes") << endl;
-    qDebug() << "restore main splitter: " << m_mainSplitter->restoreState(m_settings->value("mainSplitterSizes").toByteArray()) << endl;
+    bool restored = m_mainSplitter->restoreState(m_settings->value("mainSplitterSizes").toByteArray());
+    VDOM_LOG(General, Debug, QString("restore main splitter: %1").arg(restored ? "true" : "false"));
     m_settings->endGroup();
 }
 
@@ -185,28 +480,46 @@ void MainWindow::createWebView() {
     m_view = new WebView(this);
     WebPage* page = webPage();
 
+    preparePage(page);
+    attachPage(page, new QWebVDom(page->mainFrame()));
+
+    connect(m_view, SIGNAL(titleChanged(const QString&)),
+            this, SLOT(setWindowTitle(const QString&)));
+    connect(m_view, SIGNAL(urlChanged(const QUrl&)), this, SLOT(updateUrl(const QUrl&)));
+    connect(m_view, SIGNAL(linkClicked(const QUrl&)), this, SLOT(loadUrl(const QUrl&)));
+}
+
+/* Apply the browser settings to a page, visible or not. */
+void MainWindow::preparePage(WebPage* page) {
     page->settings()->setAttribute(QWebSettings::JavascriptEnabled, m_enableJavascript);
     page->settings()->setAttribute(QWebSettings::PluginsEnabled, m_enablePlugins);
     page->settings()->setAttribute(QWebSettings::AutoLoadImages, m_enableImages);
     page->settings()->setAttribute(QWebSettings::JavaEnabled, m_enableJava);
 
-    m_view->setPage(page);
-    m_webvdom = new QWebVDom(page->mainFrame());
     //page->setUserAgent("Mozilla/5.0 (Windows; U; Windows NT 5.1; zh-CN; rv:1.9.0.10) Gecko/2009042316 Firefox/3.0.10");
     //page->setUserAgent("Mozilla/5.0 (Windows; U; Windows NT 5.1; sv-SE) AppleWebKit/528.16 (KHTML, like Gecko) Version/4.0 Safari/528.16");
     page->setUserAgent("Mozilla/5.0 (Windows; U; Windows NT 5.1; zh-CN) AppleWebKit/528.16 (KHTML, like Gecko) Version/4.0 Safari/528.16");
 
-    connect(m_view->page(), SIGNAL(loadFinished(bool)),
+    connect(page->mainFrame(), SIGNAL(javaScriptWindowObjectCleared()),
+            this, SLOT(populateJavaScriptWindowObject()));
+}
+
+/* Wire up the page shown in the view. */
+void MainWindow::attachPage(WebPage* page, QWebVDom* vdom) {
+    m_webvdom = vdom;
+
+    connect(page, SIGNAL(loadStarted()),
+            this, SLOT(traceLoadStarted()));
+    connect(page->readiness(), SIGNAL(ready(bool)),
             this, SLOT(loadFinished(bool)));
-    connect(m_view, SIGNAL(titleChanged(const QString&)),
-            this, SLOT(setWindowTitle(const QString&)));
-    connect(m_view->page(), SIGNAL(linkHovered(const QString&, const QString&, const QString &)),
+    connect(page, SIGNAL(linkHovered(const QString&, const QString&, const QString &)),
             this, SLOT(showLinkHover(const QString&, const QString&)));
-    connect(m_view->page(), SIGNAL(windowCloseRequested()), this, SLOT(deleteLater()));
-    connect(m_view, SIGNAL(urlChanged(const QUrl&)), this, SLOT(updateUrl(const QUrl&)));
-    connect(m_view, SIGNAL(linkClicked(const QUrl&)), this, SLOT(loadUrl(const QUrl&)));
-
+    connect(page, SIGNAL(windowCloseRequested()), this, SLOT(deleteLater()));
+}
 
+/* The navigation and editing actions belong to the page, so they
+ * have to be put in place again whenever the view gets a new one. */
+void MainWindow::installPageActions() {
     m_view->pageAction(QWebPage::Back)->setShortcut(QKeySequence::Back);
     m_view->pageAction(QWebPage::Stop)->setShortcut(Qt::Key_Escape);
     m_view->pageAction(QWebPage::Forward)->setShortcut(QKeySequence::Forward);
@@ -219,6 +532,22 @@ void MainWindow::createWebView() {
     m_view->pageAction(QWebPage::ToggleBold)->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_B));
     m_view->pageAction(QWebPage::ToggleItalic)->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_I));
     m_view->pageAction(QWebPage::ToggleUnderline)->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_U));
+
+    m_navBar->insertAction(m_urlEditAction, m_view->pageAction(QWebPage::Back));
+    m_navBar->insertAction(m_urlEditAction, m_view->pageAction(QWebPage::Forward));
+    m_navBar->insertAction(m_urlEditAction, m_view->pageAction(QWebPage::Reload));
+    m_navBar->insertAction(m_urlEditAction, m_view->pageAction(QWebPage::Stop));
+
+    m_editMenu->clear();
+    m_editMenu->addAction(m_view->pageAction(QWebPage::Undo));
+    m_editMenu->addAction(m_view->pageAction(QWebPage::Redo));
+    m_editMenu->addSeparator();
+    m_editMenu->addAction(m_view->pageAction(QWebPage::Cut));
+    m_editMenu->addAction(m_view->pageAction(QWebPage::Copy));
+    m_editMenu->addAction(m_view->pageAction(QWebPage::Paste));
+
+    m_viewMenu->insertAction(m_viewMenuSeparator, m_view->pageAction(QWebPage::Stop));
+    m_viewMenu->insertAction(m_viewMenuSeparator, m_view->pageAction(QWebPage::Reload));
 }
 
 void MainWindow::createSidebar() {
@@ -235,6 +564,9 @@ void MainWindow::createSidebar() {
 
     QVBoxLayout* pageLayout = new QVBoxLayout(page);
 
+    QWidget* log = new QWidget(this);
+    QVBoxLayout* logLayout = new QVBoxLayout(log);
+
     QLabel* label = new QLabel(tr("Active item description"), item);
     itemLayout->addWidget(label);
     m_itemInfoEdit = new QTextEdit(m_sidebar);
@@ -247,15 +579,24 @@ void MainWindow::createSidebar() {
     m_pageInfoEdit->setReadOnly(true);
     pageLayout->addWidget(m_pageInfoEdit);
 
+    label = new QLabel(tr("Hunter Log"), log);
+    logLayout->addWidget(label);
+    m_hunterLog = new LogConsole(m_sidebar);
+    m_hunterLog->setMaximumLines(m_hunterLogLines);
+    logLayout->addWidget(m_hunterLog);
+
     item->setLayout(itemLayout);
     page->setLayout(pageLayout);
+    log->setLayout(logLayout);
 
     m_sidebar->addWidget(item);
     m_sidebar->addWidget(page);
+    m_sidebar->addWidget(log);
 
     m_settings->beginGroup("MainWindow");
     //qDebug() << "splitter state fron settings: " << m_settings->value("sidebarSplitterSizes") << endl;
-    qDebug() << "restore side bar splitter: " << m_sidebar->restoreState(m_settings->value("sidebarSplitterSizes").toByteArray()) << endl;
+    bool restored = m_sidebar->restoreState(m_settings->value("sidebarSplitterSizes").toByteArray());
+    VDOM_LOG(General, Debug, QString("restore side bar splitter: %1").arg(restored ? "true" : "false"));
     m_settings->endGroup();
 
     //sidebarLayout->addWidget(label);
@@ -272,7 +613,10 @@ void MainWindow::createUrlEdit() {
 
     QCompleter *completer = new QCompleter(this);
     m_urlEdit->setCompleter(completer);
-    completer->setModel(&m_urlCompleterModel);
+    completer->setModel(UrlHistory::instance()->model());
+    /* the history is kept sorted, so let the completer binary search */
+    completer->setCaseSensitivity(Qt::CaseSensitive);
+    completer->setModelSorting(QCompleter::CaseSensitivelySortedModel);
 }
 
 void MainWindow::createProgressBar() {
@@ -291,6 +635,11 @@ void MainWindow::createProgressBar() {
     m_hunterLabel->setFrameStyle(QFrame::Panel | QFrame::Sunken);
     statusBar()->addPermanentWidget(m_hunterLabel);
 
+    m_cacheLabel = new QLabel(this);
+    m_cacheLabel->hide();
+    m_cacheLabel->setFrameStyle(QFrame::Panel | QFrame::Sunken);
+    statusBar()->addPermanentWidget(m_cacheLabel);
+
     //m_iterLabel->show();
     connect(m_view, SIGNAL(loadProgress(int)), m_progress, SLOT(show()));
     connect(m_view, SIGNAL(loadProgress(int)), m_progress, SLOT(setValue(int)));
@@ -299,11 +648,10 @@ void MainWindow::createProgressBar() {
 
 void MainWindow::createToolBar() {
     QToolBar *bar = addToolBar("Navigation");
-    bar->addAction(m_view->pageAction(QWebPage::Back));
-    bar->addAction(m_view->pageAction(QWebPage::Forward));
-    bar->addAction(m_view->pageAction(QWebPage::Reload));
-    bar->addAction(m_view->pageAction(QWebPage::Stop));
-    bar->addWidget(m_urlEdit);
+    m_navBar = bar;
+    /* Back, Forward, Reload and Stop go in front of the location bar,
+     * see installPageActions() */
+    m_urlEditAction = bar->addWidget(m_urlEdit);
 
     QPushButton* loadButton = new QPushButton(tr("&Load"), this);
     connect(loadButton, SIGNAL(clicked()), SLOT(changeLocation()));
@@ -338,18 +686,20 @@ void MainWindow::createFileMenu() {
             this, SLOT(selectLineEdit()));
     fileMenu->addAction(focusAddressBar);
 
+    QAction* jumpTo = fileMenu->addAction(tr("&Jump to Iterator Page..."),
+            this, SLOT(iterJumpTo()));
+    jumpTo->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_J));
+
+    fileMenu->addAction(tr("Save Page &Image..."), this, SLOT(saveImage()));
+    fileMenu->addAction(tr("Save Page Image with &Boxes..."),
+            this, SLOT(saveAnnotatedImage()));
     fileMenu->addAction(tr("Print"), this, SLOT(print()));
     fileMenu->addAction(tr("Close"), this, SLOT(close()));
 }
 
 void MainWindow::createEditMenu() {
-    QMenu *editMenu = menuBar()->addMenu("&Edit");
-    editMenu->addAction(m_view->pageAction(QWebPage::Undo));
-    editMenu->addAction(m_view->pageAction(QWebPage::Redo));
-    editMenu->addSeparator();
-    editMenu->addAction(m_view->pageAction(QWebPage::Cut));
-    editMenu->addAction(m_view->pageAction(QWebPage::Copy));
-    editMenu->addAction(m_view->pageAction(QWebPage::Paste));
+    /* filled in by installPageActions() */
+    m_editMenu = menuBar()->addMenu("&Edit");
     //editMenu->addSeparator();
     //QAction *setEditable = editMenu->addAction(tr("Set Editable"), this, SLOT(setEditable(bool)));
     //setEditable->setCheckable(true);
@@ -357,9 +707,9 @@ void MainWindow::createEditMenu() {
 
 void MainWindow::createViewMenu() {
     QMenu *viewMenu = menuBar()->addMenu(tr("&View"));
-    viewMenu->addAction(m_view->pageAction(QWebPage::Stop));
-    viewMenu->addAction(m_view->pageAction(QWebPage::Reload));
-    viewMenu->addSeparator();
+    m_viewMenu = viewMenu;
+    /* Stop and Reload go above, see installPageActions() */
+    m_viewMenuSeparator = viewMenu->addSeparator();
 
     QAction *zoomIn = viewMenu->addAction(tr("Zoom &In"), this, SLOT(zoomIn()));
     zoomIn->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_Plus));
@@ -436,9 +786,18 @@ void MainWindow::writeSettings() {
     m_settings->setValue("hunterEnabled", QVariant(m_hunterEnabled));
     m_settings->setValue("hunterPath", m_hunterPath);
     m_settings->setValue("vdomPath", m_vdomPath);
+    m_settings->setValue("hunterTransport", m_hunterTransport);
+    m_settings->setValue("hunterDumpFormat", m_hunterDumpFormat);
+    m_settings->setValue("hunterPoolSize", m_hunterPoolSize);
+    m_settings->setValue("hunterDeadline", m_hunterDeadline);
+    m_settings->setValue("hunterMemoryLimit", m_hunterMemoryLimit);
+    m_settings->setValue("hunterLogLines", m_hunterLogLines);
+    m_settings->setValue("hunterLogDir", m_hunterLogDir);
 
     m_settings->setValue("iteratorEnabled", QVariant(m_iteratorEnabled));
     m_settings->setValue("urlListFile", QVariant(m_urlListFile));
+    m_settings->setValue("prefetchPages", m_prefetchPages);
+    m_settings->setValue("prefetchMemory", m_prefetchMemory);
     //m_settings->setValue("iteratorCurrentIndex", QVariant(m_iterator.cur()));
     m_settings->setValue("sidebarSplitterSizes", m_sidebar->saveState());
     m_settings->setValue("mainSplitterSizes", m_mainSplitter->saveState());
@@ -465,11 +824,24 @@ void MainWindow::readSettings() {
 
     m_hunterPath = m_settings->value("hunterPath").toString();
     m_vdomPath   = m_settings->value("vdomPath").toString();
+    m_hunterTransport = m_settings->value("hunterTransport",
+            HunterConfigDialog::FileTransport).toInt();
+    m_hunterDumpFormat = m_settings->value("hunterDumpFormat",
+            VdomBinary::TextDump).toInt();
+    m_hunterPoolSize = m_settings->value("hunterPoolSize", 2).toInt();
+    m_hunterDeadline = m_settings->value("hunterDeadline", 30).toInt();
+    m_hunterMemoryLimit = m_settings->value("hunterMemoryLimit", 1024).toInt();
+    m_hunterLogLines = m_settings->value("hunterLogLines", 1000).toInt();
+    m_hunterLogDir = m_settings->value("hunterLogDir").toString();
     initHunterConfig();
+    configureHunterPool();
 
     m_iteratorEnabled = m_settings->value("iteratorEnabled").toBool();
     m_urlListFile = m_settings->value("urlListFile").toString();
+    m_prefetchPages = m_settings->value("prefetchPages", 1).toInt();
+    m_prefetchMemory = m_settings->value("prefetchMemory", 256).toInt();
     initIteratorConfig();
+    configurePrefetcher();
 
     //m_iterator.setCur(m_settings->value("iteratorCurrentIndex", 0).toInt());
     initIterator();
@@ -492,6 +864,16 @@ void MainWindow::saveHunterConfig() {
     //m_hunterPath = m_hunterConfig->progPath();
     m_hunterPath = m_hunterConfig->progPath();
     m_vdomPath   = m_hunterConfig->vdomPath();
+    m_hunterTransport = m_hunterConfig->transport();
+    m_hunterDumpFormat = m_hunterConfig->dumpFormat();
+    m_hunterPoolSize = m_hunterConfig->poolSize();
+    m_hunterDeadline = m_hunterConfig->deadline();
+    m_hunterMemoryLimit = m_hunterConfig->memoryLimit();
+    m_hunterLogLines = m_hunterConfig->logLines();
+    m_hunterLogDir = m_hunterConfig->logDir();
+    m_hunterLog->setMaximumLines(m_hunterLogLines);
+    configureHunterPool();
+    configurePrefetcher();
     //qDebug() << "Saving hunter config... (hunter: " << m_hunterPath << ")";
 }
 
@@ -500,102 +882,167 @@ void MainWindow::saveIteratorConfig() {
     m_iterPrevButton->setEnabled(m_iteratorEnabled);
     m_iterNextButton->setEnabled(m_iteratorEnabled);
     m_urlListFile = m_iteratorConfig->listFile();
+    m_prefetchPages = m_iteratorConfig->prefetchPages();
+    m_prefetchMemory = m_iteratorConfig->prefetchMemory();
     if (m_iteratorEnabled) {
         m_iterLabel->show();
     } else {
         m_iterLabel->hide();
     }
 
+    configurePrefetcher();
     initIterator();
 }
 
-void MainWindow::hunterFinished(int exitCode, QProcess::ExitStatus) {
-    if (exitCode != 0) {
-        QString msg = QString("Failed to spawn X Hunter %1: %2: "
-                "Process returns exit code %3.")
+void MainWindow::hunterPoolResult(int jobId, const QByteArray& result) {
+    if (jobId != m_hunterJobId) {
+        /* stale result of a page we have already left */
+        return;
+    }
+    m_hunterJobId = -1;
+    m_hunterResult = result;
+    m_hunterResultReady = true;
+    hunterFinished(0, QProcess::NormalExit);
+}
+
+void MainWindow::hunterPoolFailed(int jobId, const QString& error) {
+    if (jobId != m_hunterJobId) {
+        return;
+    }
+    m_hunterJobId = -1;
+    m_hunterError = error;
+    hunterFinished(-1, QProcess::NormalExit);
+}
+
+void MainWindow::hunterFinished(int exitCode, QProcess::ExitStatus exitStatus) {
+    if (Tracer::isEnabled()) {
+        Tracer::instance()->span(m_tracePage, "hunt", m_huntStart, Tracer::now());
+    }
+    /* a killed hunter can report exit code 0; what it left is no
+     * result, let alone one to cache */
+    if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+        QString msg = QString("Failed to spawn X Hunter %1: %2: %3")
                 .arg(m_hunterPath)
-                .arg(m_hunter.errorString())
-                .arg(m_hunter.exitCode());
-        m_itemInfoEdit->append(msg);
-        QMessageBox::warning(this, tr("Hunter runner"),
-                msg, QMessageBox::NoButton);
+                .arg(m_hunterTransport == HunterConfigDialog::PoolTransport
+                        ? m_hunterError : m_hunter.errorString())
+                .arg(exitStatus != QProcess::NormalExit
+                        ? QString("Process crashed.")
+                        : QString("Process returns exit code %1.").arg(exitCode));
+        traceEndPage("hunter failed");
+        reportError(msg);
         return;
     }
     statusBar()->showMessage(
         QString("Finished running X Hunter %1. (exit code: %2)")
                 .arg(m_hunterPath).arg(exitCode));
 
+    if (m_hunterTransport != HunterConfigDialog::FileTransport) {
+        if (m_hunterTransport == HunterConfigDialog::PipeTransport) {
+            /* drain whatever is still sitting in the pipe */
+            emitHunterStdout();
+        }
+        if (!m_hunterResultReady) {
+            traceEndPage("hunter failed");
+            reportError(QString("Hunter %1 exited without sending a complete "
+                    "result frame on stdout.").arg(m_hunterPath));
+            return;
+        }
+        m_resultCache.storeData(m_huntKey, m_hunterResult);
+        m_huntKey.clear();
+        parseHunterResult(m_hunterResult, m_hunterPath + " stdout");
+        m_hunterResult.clear();
+        m_hunterResultReady = false;
+        return;
+    }
+
     /* Process the .res output file by hunter programs */
 
     QString resFile = m_vdomPath + ".res";
     if (!QFile::exists(resFile)) {
-        QMessageBox::warning(this, tr("Hunter Result File Checker"),
-            QString("Hunter result data file \"%1\"not found.").
-                arg(resFile),
-            QMessageBox::NoButton);
+        traceEndPage("hunter failed");
+        reportError(QString("Hunter result data file \"%1\" not found.")
+                .arg(resFile));
         return;
     }
+    m_resultCache.storeFile(m_huntKey, resFile);
+    m_huntKey.clear();
+    parseHunterResultFile(resFile);
+}
 
-    QFile file(resFile);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, tr("Hunter Result File Loader"),
-            QString("Failed to load hunter result file %1: %2")
-                .arg(resFile).arg(file.errorString()),
-                QMessageBox::NoButton);
-        file.close();
+void MainWindow::emitHunterStdout() {
+    const QByteArray& data = m_hunter.readAllStandardOutput();
+    if (m_hunterTransport != HunterConfigDialog::PipeTransport) {
+        m_hunterLog->append(QString::fromUtf8(data));
         return;
     }
-    QString json = QString::fromUtf8(file.readAll());
-    //qDebug() << "RAW JSON: " << json << endl;
-    file.close();
-    if (json.isEmpty()) {
-        QMessageBox::warning(this, tr("Hunter Result File Loader"),
-            QString("Result file %1: %2")
-                .arg(m_vdomPath).arg(file.errorString()),
-                QMessageBox::NoButton);
-        return;
+    m_hunterFrames.append(data);
+    if (!m_hunterResultReady && m_hunterFrames.takeFrame(m_hunterResult)) {
+        m_hunterResultReady = true;
+    }
+    if (m_hunterFrames.hasError()) {
+        m_hunterLog->append(QString("Malformed result frame from hunter %1.")
+                .arg(m_hunterPath));
+        m_hunterFrames.reset();
     }
+}
 
-    bool status = true;
-    QVariant res = m_jsonDriver.parse(json, &status);
-    if (status) {
-        QMessageBox::warning(this, tr("Hunter Result File Loader"),
-            QString("Failed to parse JSON in file %1: line %2: %3")
-                .arg(resFile)
-                .arg(m_jsonDriver.errorLine())
-                .arg(m_jsonDriver.error()),
-            QMessageBox::NoButton);
+/* The parser thread reads and decodes the result; we pick it up in
+ * hunterGroupsParsed() and hunterResultParsed(). */
+void MainWindow::parseHunterResult(const QByteArray& data, const QString& source) {
+    m_parseStart = Tracer::isEnabled() ? Tracer::now() : 0;
+    m_resultParseId++;
+    m_annotating = false;
+    m_resultParser->supersede(m_resultParseId);
+    QMetaObject::invokeMethod(m_resultParser, "parseData",
+            Qt::QueuedConnection,
+            Q_ARG(int, m_resultParseId), Q_ARG(QByteArray, data),
+            Q_ARG(QString, source));
+}
+
+void MainWindow::parseHunterResultFile(const QString& path) {
+    m_parseStart = Tracer::isEnabled() ? Tracer::now() : 0;
+    m_resultParseId++;
+    m_annotating = false;
+    m_resultParser->supersede(m_resultParseId);
+    QMetaObject::invokeMethod(m_resultParser, "parseFile",
+            Qt::QueuedConnection,
+            Q_ARG(int, m_resultParseId), Q_ARG(QString, path));
+}
+
+void MainWindow::hunterGroupsParsed(int id, int offset, const QVariantList& groups) {
+    if (id != m_resultParseId) {
         return;
     }
-    //qDebug() << "Res: " << res << endl;
-    if (!res.canConvert<QVariantMap>()) {
-        QMessageBox::warning(this, tr("Hunter Result File Loader"),
-            QString("Result file %1 does not contain a JSON object.")
-                .arg(resFile),
-            QMessageBox::NoButton);
-        return;
+    if (!m_annotating) {
+        beginAnnotation();
+    }
+    if (offset == 0) {
+        m_huntedGroups.clear();
     }
+    m_huntedGroups += groups;
+    annotateGroups(groups, offset);
+}
 
-    const QVariantMap root = res.toMap();
-    QWebFrame* frame = m_view->page()->mainFrame();
+void MainWindow::hunterResultFailed(int id, const QString& error) {
+    if (id != m_resultParseId) {
+        return;
+    }
+    traceEndPage("parse failed");
+    reportError(error);
+}
 
-    QVariant groupsVar = root["groups"];
-    if (!groupsVar.isNull() && groupsVar.canConvert<QVariantList>()) {
-        QVariantList groups = groupsVar.toList();
-        if ( ! groups.isEmpty() ) {
-            if (!m_enableJavascript) {
-                m_view->page()->settings()->setAttribute(QWebSettings::JavascriptEnabled, true);
-            }
-            frame->addToJavaScriptWindowObject("itemInfoEdit", m_itemInfoEdit);
-            frame->addToJavaScriptWindowObject("statusBar", statusBar());
-
-            if (!m_enableJavascript) {
-                m_view->page()->settings()->setAttribute(QWebSettings::JavascriptEnabled, false);
-            }
-            //evalJS("window.resData=" + json + ";return true");
-            annotateWebPage(groups);
-        }
+void MainWindow::hunterResultParsed(int id, const QVariantMap& root) {
+    if (id != m_resultParseId) {
+        return;
     }
+    if (Tracer::isEnabled()) {
+        /* wall time; overlaps the annotation of the first batches */
+        Tracer::instance()->span(m_tracePage, "parse", m_parseStart, Tracer::now());
+    }
+    if (m_annotating) {
+        endAnnotation();
+    }
+    QWebFrame* frame = m_view->page()->mainFrame();
 
     QVariant programMeta = root["program"];
     if (!programMeta.isNull() && programMeta.canConvert<QString>()) {
@@ -624,133 +1071,94 @@ void MainWindow::hunterFinished(int exitCode, QProcess::ExitStatus) {
         QString txt = summary.toString();
         m_pageInfoEdit->setText(txt);
     }
+    traceEndPage();
 }
 
 QVariant MainWindow::evalJS(const QString& js) {
     return m_view->page()->mainFrame()->evaluateJavaScript(js);
 }
 
-void MainWindow::annotateWebPage(QVariantList& groups) {
-    QVariantList::iterator itI;
-    int i = 0;
-    QString js = "window.addEventListener('mousedown',"
-        "function (e) {"
-          "if (window._vdom_selected) return;"
-          "if (!e.target) return;"
-          "if (e.target.className && "
-                "/\\bvdom-result\\b/.test(e.target.className)) {"
-            "window._vdom_selected = e.target;"
-          "}"
-        "}, true);"
-        "window.addEventListener('keydown',"
-          "function (e) {"
-            "if (e.keyCode == 27 && window._vdom_selected) {"
-              "var node = window._vdom_selected;"
-              "delete window._vdom_selected;"
-              "var event = document.createEvent('MouseEvents');"
-              "event.initMouseEvent('mouseout', true, true);"
-              "node.dispatchEvent(event);"
-              "return;"
-            "}"
-          "}, true);";
-    QVariant res = evalJS(js + "true");
-
-    for (itI = groups.begin(); itI != groups.end(); i++, itI++) {
-        QVariant groupVar = *itI;
-        if (groupVar.canConvert<QVariantList>()) {
-            QVariantList group = groupVar.toList();
-            QVariantList::iterator itJ;
-            for (itJ = group.begin(); itJ != group.end(); itJ++) {
-                QVariant itemVar = *itJ;
-                if (itemVar.canConvert<QVariantMap>()) {
-                    QVariantMap item = itemVar.toMap();
-                    //qDebug() << item << endl;
-                    if (item["borderWidth"].isNull()) {
-                        item["borderWidth"] = QVariant(2);
-                    }
-                    if (item["borderColor"].isNull()) {
-                        item["borderColor"] = QVariant("red");
-                    }
-                    if (item["borderStyle"].isNull()) {
-                        item["borderStyle"] = QVariant("solid");
-                    }
-                    QString js = QString(
-            "var box = document.createElement('div');"
-            "var style = box.style;"
-            "style.borderWidth = '%1px';"
-            "style.borderColor = '%2';"
-            "style.borderStyle = '%3';"
-            "style.position = 'absolute';"
-            "style.left   = '%4px';"
-            "style.top    = '%5px';"
-            "style.width  = '%6px';"
-            "style.height = '%7px';"
-            "box.className = 'vdom-result vdom-group-%8';"
-            "document.body.appendChild(box);")
-                        .arg(item["borderWidth"].toString())
-                        .arg(item["borderColor"].toString())
-                        .arg(item["borderStyle"].toString())
-                        .arg(item["x"].toInt())
-                        .arg(item["y"].toInt())
-                        .arg(item["w"].toInt())
-                        .arg(item["h"].toInt())
-                        .arg(i);
-                    QVariant noHighlight = item["noHighlight"];
-                    if (noHighlight.isNull() ||
-                            (noHighlight.canConvert<bool>() &&
-                            !noHighlight.toBool())) {
-                        QVariant descVar = item["desc"];
-                        if (descVar.isNull() || !descVar.canConvert<QString>()) {
-                            descVar = QVariant("");
-                        }
-                        QVariant titleVar = item["title"];
-                        if (titleVar.isNull() || !titleVar.canConvert<QString>()) {
-                            titleVar = QVariant("");
-                        }
-                        js += QString("box.addEventListener('mouseover',"
-                            "function (e) {"
-                              "if (window._vdom_selected) return;"
-                              "itemInfoEdit.plainText = %1;"
-                              "statusBar.showMessage(%2);"
-                              "nodes = document.getElementsByClassName('vdom-group-%3');"
-                              "for (var i = 0; i < nodes.length; i++) {"
-                                "var node = nodes[i];"
-                                "node.setAttribute('_vdom_color', node.style.borderColor);"
-                                "node.style.borderColor = 'yellow';"
-                              "}"
-                            "},"
-                            "true);")
-                                .arg(m_webvdom->dumpStrAsJson(
-                                        descVar.toString()))
-                                .arg(m_webvdom->dumpStrAsJson(
-                                        titleVar.toString()))
-                                .arg(i);
-                        //qDebug() << "JSON: " << js << endl;
-                        js += QString("box.addEventListener('mouseout',"
-                            "function (e) {"
-                              "if (window._vdom_selected) return;"
-                              "nodes = document.getElementsByClassName('vdom-group-%1');"
-                              "for (var i = 0; i < nodes.length; i++) {"
-                                "var node = nodes[i];"
-                                "node.style.borderColor = node.getAttribute('_vdom_color');"
-                              "}"
-                            "},"
-                            "true);").arg(i);
-                        //qDebug() << js << endl;
-                    }
-                    //qDebug() << i << ":" << j << ": " << js << endl;
-                    QVariant res = evalJS(js + "true");
-                    //if (!res.isNull()) {
-                    //qDebug() << "res: " << res << endl;
-                    //}
-                }
-            }
-        }
+void MainWindow::installAnnotationLib() {
+    /* installed once per page; the library keeps its own state
+     * (box pool, group map) in a closure */
+    QVariant res = evalJS(
+        "typeof window._vdom_annotate == 'object'");
+    if (res.toBool()) {
+        return;
     }
+    evalJS(QString::fromLatin1(ANNOTATION_LIB) + "true");
+}
+
+void MainWindow::beginAnnotation() {
+    TraceScope scope(m_tracePage, "annotate");
+    m_annotating = true;
+    QWebFrame* frame = m_view->page()->mainFrame();
+    if (!m_enableJavascript) {
+        m_view->page()->settings()->setAttribute(QWebSettings::JavascriptEnabled, true);
+    }
+    frame->addToJavaScriptWindowObject("itemInfoEdit", m_itemInfoEdit);
+    frame->addToJavaScriptWindowObject("statusBar", statusBar());
+
+    if (!m_enableJavascript) {
+        m_view->page()->settings()->setAttribute(QWebSettings::JavascriptEnabled, false);
+    }
+    installAnnotationLib();
+    evalJS("window._vdom_annotate.begin(); true");
+}
+
+void MainWindow::annotateGroups(const QVariantList& groups, int offset) {
+    TraceScope scope(m_tracePage, "annotate");
+    QByteArray payload = JsonWriter::toJson(QVariant(groups));
+    evalJS(QString("window._vdom_annotate.add(%1, %2); true")
+            .arg(QString::fromUtf8(payload)).arg(offset));
+    m_view->update();
+}
+
+void MainWindow::endAnnotation() {
+    TraceScope scope(m_tracePage, "annotate");
+    m_annotating = false;
+    evalJS("window._vdom_annotate.end(); true");
     m_view->update();
     m_view->page()->settings()->setAttribute(QWebSettings::JavascriptEnabled, true);
 }
 
+void MainWindow::saveImage(bool boxes) {
+    if (boxes && m_huntedGroups.isEmpty()) {
+        QMessageBox::warning(this, tr("Save Page Image"),
+            tr("There are no hunter results for this page."),
+            QMessageBox::NoButton);
+        return;
+    }
+    QString path = QFileDialog::getSaveFileName(this, tr("Save Page Image"),
+        QString(), tr("Images (*.png *.jpg)"));
+    if (path.isEmpty()) {
+        return;
+    }
+    /* tall pages are written in tiles: <base>.0.png, <base>.1.png, ... */
+    QFileInfo info(path);
+    QString suffix = info.suffix().toLower();
+    m_capture->setFormat(suffix == "jpg" || suffix == "jpeg" ? "jpg" : "png");
+    QString base = suffix.isEmpty() ? path
+        : path.left(path.length() - suffix.length() - 1);
+
+    /* the boxes are drawn by the capture, and the annotation layer
+     * would only cover them */
+    evalJS("if (window._vdom_annotate) window._vdom_annotate.show(false); true");
+    int tiles = m_capture->capture(m_view->page()->mainFrame(), base,
+            boxes ? m_huntedGroups : QVariantList());
+    evalJS("if (window._vdom_annotate) window._vdom_annotate.show(true); true");
+    statusBar()->showMessage(tr("Writing %1 image tile(s) to %2.*")
+            .arg(tiles).arg(base));
+}
+
+void MainWindow::imageTileWritten(const QString& path, const QString& error) {
+    if (!error.isEmpty()) {
+        statusBar()->showMessage(error);
+    } else if (m_capture->pending() == 0) {
+        statusBar()->showMessage(tr("Wrote %1").arg(path));
+    }
+}
+
 void MainWindow::huntOnly() {
     if (!m_hunterEnabled) {
         QMessageBox::warning(this, tr("Hunt Only"),
@@ -758,22 +1166,65 @@ void MainWindow::huntOnly() {
             QMessageBox::NoButton);
         return;
     }
-    QString js = "var nodes = document.getElementsByClassName('vdom-result');"
-        "for (var i = 0; i < nodes.length; i++) {"
-          "nodes[i].style.display = 'none';"
-        "} true";
-    //qDebug() << js << endl;
-    evalJS(js);
+    m_huntedGroups.clear();
+    /* drop the old boxes instead of just hiding them */
+    evalJS("if (window._vdom_annotate) {"
+             "window._vdom_annotate.begin();"
+             "window._vdom_annotate.end();"
+           "} true");
     //qDebug() <<  << endl;
     //m_view->update();
     //QMessageBox::warning(this, "hi", "Done!", QMessageBox::NoButton);
-    loadFinished(true);
+
+    /* the scripts ran when the page loaded; just dump it afresh, the
+     * page may have changed in ways no DOM event tells of, and hunt
+     * again */
+    if (Tracer::isEnabled()) {
+        traceEndPage("abandoned");
+        m_tracePage = Tracer::instance()->beginPage(
+                QString::fromUtf8(m_view->url().toEncoded()));
+    }
+    QByteArray vdom;
+    {
+        TraceScope scope(m_tracePage, "dump");
+        vdom = m_webvdom->dump();
+    }
+    runHunter(vdom, true);
 }
 
 void MainWindow::initHunterConfig() {
     m_hunterConfig->setHunterEnabled(m_hunterEnabled);
     m_hunterConfig->setProgPath(m_hunterPath);
     m_hunterConfig->setVdomPath(m_vdomPath);
+    m_hunterConfig->setTransport(m_hunterTransport);
+    m_hunterConfig->setDumpFormat(m_hunterDumpFormat);
+    m_hunterConfig->setPoolSize(m_hunterPoolSize);
+    m_hunterConfig->setDeadline(m_hunterDeadline);
+    m_hunterConfig->setMemoryLimit(m_hunterMemoryLimit);
+    m_hunterConfig->setLogLines(m_hunterLogLines);
+    m_hunterConfig->setLogDir(m_hunterLogDir);
+}
+
+void MainWindow::startHunterLog() {
+    QString url = QString::fromUtf8(m_view->url().toEncoded());
+    if (m_hunterLogDir.isEmpty()) {
+        m_hunterLog->setSpillFile(QString());
+    } else {
+        QString path = QString("%1/hunter-%2.log")
+            .arg(m_hunterLogDir)
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss-zzz"));
+        m_hunterLog->setSpillFile(path);
+    }
+    m_hunterLog->append(QString("--- %1 ---").arg(url));
+}
+
+void MainWindow::configureHunterPool() {
+    if (!m_hunterEnabled || m_hunterPath.isEmpty() ||
+            m_hunterTransport != HunterConfigDialog::PoolTransport) {
+        return;
+    }
+    m_hunterPool->configure(m_hunterPath, m_hunterPoolSize,
+            m_hunterDeadline * 1000, m_hunterMemoryLimit);
 }
 
 void MainWindow::initIteratorConfig() {
@@ -787,6 +1238,8 @@ void MainWindow::initIteratorConfig() {
     }
     //update();
     m_iteratorConfig->setListFile(m_urlListFile);
+    m_iteratorConfig->setPrefetchPages(m_prefetchPages);
+    m_iteratorConfig->setPrefetchMemory(m_prefetchMemory);
 }
 
 void MainWindow::addUrlToList() {
@@ -796,86 +1249,183 @@ void MainWindow::addUrlToList() {
     opts |= QUrl::StripTrailingSlash;
     QString s = m_view->url().toEncoded(opts);
     s = s.mid(2);
-    if (!s.isEmpty()) {
-        if (!m_urlList.contains(s))
-            m_urlList += s;
-        m_urlCompleterModel.setStringList(m_urlList);
-    }
+    UrlHistory::instance()->add(s);
 }
 
 void MainWindow::iterPrev() {
     int ind = m_iterator.prev();
     if (ind < 0) {
-        qDebug() << "Iterator index negative: " << ind << endl;
+        VDOM_LOG(General, Warning, QString("Iterator index negative: %1").arg(ind));
         return;
     }
-    if (ind >= m_urlList.count()) {
-        m_iterator.setCur(0);
-        m_iterator.setCount(m_urlList.count());
-        ind = 0;
-    }
-    m_iterLabel->setText("Page " + QString::number(ind));
-    if (ind >= 0 && ind < m_urlList.count()) {
-        QString url = "http://";
-        url += m_urlList[ind];
-        m_urlEdit->setText(url);
-        loadUrl(url);
-    }
+    loadIterPage(ind);
 }
 
 void MainWindow::iterNext() {
     int ind = m_iterator.next();
     if (ind < 0) {
-        qDebug() << "Iterator index negative: " << ind << endl;
+        VDOM_LOG(General, Warning, QString("Iterator index negative: %1").arg(ind));
         return;
     }
-    if (ind >= m_urlList.count()) {
-        m_iterator.setCur(0);
-        m_iterator.setCount(m_urlList.count());
-        ind = 0;
+    loadIterPage(ind);
+}
+
+void MainWindow::iterJumpTo() {
+    if (!m_iteratorEnabled || m_iterator.count() <= 0) {
+        return;
     }
-    m_iterLabel->setText("Page " + QString::number(ind));
-    if (ind >= 0 && ind < m_urlList.count()) {
-        QString url = "http://";
-        url += m_urlList[ind];
-        m_urlEdit->setText(url);
-        loadUrl(url);
+    bool ok;
+    int ind = QInputDialog::getInt(this, tr("Jump to Page"),
+            tr("Page (0 - %1):").arg(m_iterator.count() - 1),
+            qMax(m_iterator.cur(), 0), 0, m_iterator.count() - 1, 1, &ok);
+    if (!ok) {
+        return;
     }
+    loadIterPage(m_iterator.jumpTo(ind));
+}
+
+void MainWindow::loadIterPage(int ind) {
+    updateIterLabel();
+    if (ind < 0 || ind >= m_iterUrls->count()) {
+        return;
+    }
+    PrefetchedPage* prefetched = m_prefetcher->take(ind);
+    if (prefetched) {
+        showPrefetchedPage(prefetched);
+        return;
+    }
+    QString url = iterUrl(ind);
+    m_urlEdit->setText(url);
+    loadUrl(url);
+}
+
+QString MainWindow::iterUrl(int ind) const {
+    QString url = m_iterUrls->at(ind);
+    url.replace(QRegExp("^[A-Za-z]+://"), "");
+    url.prepend("http://");
+    return url;
+}
+
+/* Swap a page loaded by the prefetcher into the view. If it is done
+ * loading, its dump and hunter result (when already there) are used
+ * instead of running through loadFinished() again. */
+void MainWindow::showPrefetchedPage(PrefetchedPage* prefetched) {
+    m_view->stop();
+    delete m_webvdom;
+    prefetched->page->setHeadless(false);
+    m_view->setWebPage(prefetched->page);
+    attachPage(prefetched->page, prefetched->vdom);
+    installPageActions();
+    /* for a page still loading, "load" is only the part we waited */
+    traceLoadStarted();
+
+    if (!prefetched->loaded) {
+        /* loadFinished() takes over from here */
+        m_urlEdit->setText(prefetched->url.toEncoded());
+        delete prefetched;
+        return;
+    }
+
+    setWindowTitle(m_view->title());
+    m_urlEdit->setText(m_view->url().toEncoded());
+    addUrlToList();
+    m_progress->hide();
+
+    if (m_hunterEnabled) {
+        if (prefetched->hunterDone) {
+            resetHunt();
+            parseHunterResult(prefetched->hunterResult,
+                    m_hunterPath + " (prefetched)");
+        } else if (prefetched->hunterJobId >= 0) {
+            /* still being hunted; hunterPoolResult() picks it up */
+            resetHunt();
+            m_hunterJobId = prefetched->hunterJobId;
+        } else if (!prefetched->dump.isEmpty()) {
+            runHunter(prefetched->dump);
+        } else {
+            runHunter(m_webvdom->dump());
+        }
+    }
+    delete prefetched;
+    schedulePrefetch();
+}
+
+void MainWindow::traceLoadStarted() {
+    if (!Tracer::isEnabled()) {
+        return;
+    }
+    traceEndPage("abandoned");
+    m_tracePage = Tracer::instance()->beginPage();
+    m_loadStart = Tracer::now();
+}
+
+void MainWindow::traceEndPage(const char* outcome) {
+    Tracer::instance()->endPage(m_tracePage, outcome);
+    m_tracePage = -1;
+}
+
+void MainWindow::prefetchedPageLoaded(WebPage* page) {
+    injectJS(page->mainFrame(), m_injectedJSFiles);
+}
+
+void MainWindow::schedulePrefetch() {
+    if (!m_iteratorEnabled || m_prefetcher->depth() == 0) {
+        return;
+    }
+    int count = m_iterator.count();
+    int cur = m_iterator.cur();
+    QList<int> indexes;
+    QList<QUrl> urls;
+    /* the pages iterNext() will go to, wrapping around like it does */
+    for (int i = 1; i <= m_prefetcher->depth() && i < count; i++) {
+        int ind = (cur + i) % count;
+        indexes << ind;
+        urls << QUrl(iterUrl(ind));
+    }
+    m_prefetcher->setViewportSize(m_view->page()->viewportSize());
+    m_prefetcher->prefetch(indexes, urls);
+}
+
+void MainWindow::configurePrefetcher() {
+    /* pages prefetched under the old settings are of no use */
+    m_prefetcher->clear();
+    m_prefetcher->setDepth(m_iteratorEnabled ? m_prefetchPages : 0);
+    m_prefetcher->setMemoryLimit(m_prefetchMemory);
+    m_prefetcher->setHunter(m_hunterEnabled,
+            m_hunterTransport == HunterConfigDialog::PoolTransport
+                ? m_hunterPool : 0);
+    m_prefetcher->setDumpFormat(m_hunterDumpFormat);
+}
+
+void MainWindow::updateIterLabel() {
+    m_iterLabel->setText(QString("Page %1 of %2%3")
+            .arg(m_iterator.cur())
+            .arg(m_iterator.count())
+            .arg(m_iterUrls->isComplete() ? "" : "+"));
+}
+
+void MainWindow::iterListGrown(int count) {
+    m_iterator.updateCount(count);
+    updateIterLabel();
 }
 
 void MainWindow::initIterator() {
+    m_prefetcher->clear();
     if (!m_iteratorEnabled) {
         return;
     }
-    QFile file(m_urlListFile);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    /* maps the file and indexes the first lines right away; the rest
+     * is indexed in the background, see iterListGrown() */
+    if (!m_iterUrls->open(m_urlListFile)) {
         QMessageBox::warning(this, tr("URL List File Loader"),
             QString("Failed to load url list file %1: %2")
-                .arg(m_urlListFile).arg(file.errorString()),
+                .arg(m_urlListFile).arg(m_iterUrls->errorString()),
                 QMessageBox::NoButton);
-        file.close();
+        m_iterator.setCount(0);
         return;
     }
-    m_urlList.clear();
-    QString line = QString::fromUtf8(file.readLine(MAX_FILE_LINE_LEN));
-    QRegExp emptyLinePat("^\\s*$");
-    while (!line.isEmpty()) {
-        if (emptyLinePat.exactMatch(line)) {
-            //qDebug() << "Empty line pattern found.\n";
-        } else {
-            //qDebug() << "Read line " << line;
-            line = line.trimmed();
-            line.replace(QRegExp("^[A-Za-z]+://"), "");
-            //qDebug() << "URL: " << line << endl;
-            m_urlList.push_back(line);
-        }
-        line = QString::fromUtf8(file.readLine(MAX_FILE_LINE_LEN));
-    }
-    //QString json = QString::fromUtf8(file.readAll());
-    //qDebug() << "RAW JSON: " << json << endl;
-    file.close();
-    m_iterator.setCount(m_urlList.count());
-    m_iterLabel->setText("Page " + QString::number(m_iterator.cur()));
+    m_iterator.setCount(m_iterUrls->count());
+    updateIterLabel();
 }
 
 void MainWindow::execHunterConfig() {
@@ -908,3 +1458,44 @@ void MainWindow::setJSFiles(QStringList& jsFiles) {
         //qDebug() << "!!! JS: " << m_injectedJS << endl;
 }
 
+void MainWindow::setEarlyJSFiles(const QStringList& jsFiles) {
+    m_earlyJSFiles = jsFiles;
+}
+
+void MainWindow::populateJavaScriptWindowObject() {
+    /* prefetched pages are set up the same way as the visible one */
+    QWebFrame* frame = qobject_cast<QWebFrame*>(sender());
+    if (!frame) {
+        frame = m_view->page()->mainFrame();
+    }
+    frame->addToJavaScriptWindowObject("vdom_external_call", this);
+    m_fileBridge->install(frame);
+    m_processPool->install(frame);
+    /* runs before any script of the new page */
+    injectJS(frame, m_earlyJSFiles);
+}
+
+void MainWindow::processFinished(int id, int exitCode, const QString& error) {
+    QString callback = m_processCallbacks.take(id);
+    if (callback.isEmpty()) {
+        /* run through window.vdom_proc, which has its own callbacks */
+        return;
+    }
+    if (!error.isEmpty()) {
+        m_hunterLog->append(QString("callProcess: %1").arg(error));
+    }
+    m_view->page()->mainFrame()->evaluateJavaScript(
+            callback + "(" + QString::number(exitCode) + ");");
+}
+
+void MainWindow::injectJS(QWebFrame* frame, const QStringList& jsFiles) {
+    for (int i = 0; i < jsFiles.count(); i++) {
+        const QString& injectedJS = ScriptCache::instance()->script(jsFiles[i]);
+        if (injectedJS.isNull()) {
+            continue;
+        }
+        QVariant res = frame->evaluateJavaScript(injectedJS + "true");
+        VDOM_LOG(General, Debug, "injecting JS res: " + res.toString());
+    }
+}
+
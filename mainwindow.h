@@ -1,8 +1,6 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
-/* from QJson: http://qjson.sourceforge.net/docs/index.html */
-#include <qjson/json_driver.hh>
 #include <qwebvdom.h> /* added to WebCore by Yahoo! China EEEE */
 #include <qwebview.h>
 #include <qwebframe.h>
@@ -10,10 +8,24 @@
 #include <QtGui>
 
 #include "lineedit.h"
+#include "logconsole.h"
 #include "aboutdialog.h"
 #include "hunterconfigdialog.h"
 #include "iteratorconfigdialog.h"
 #include "iterator.h"
+#include "urllist.h"
+#include "urlhistory.h"
+#include "hunterprotocol.h"
+#include "hunterpool.h"
+#include "hunterresultparser.h"
+#include "vdombinary.h"
+#include "pageprefetcher.h"
+#include "pagecapture.h"
+#include "dumppipeline.h"
+#include "filebridge.h"
+#include "processpool.h"
+#include "logger.h"
+#include "hunterresultcache.h"
 
 //#include <qwebselected.h>
 #include "webview.h"
@@ -24,6 +36,7 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 public:
     MainWindow(const QString& url = QString());
+    ~MainWindow();
 
     WebPage* webPage() const {
         return (WebPage*) m_view->page();
@@ -34,29 +47,35 @@ public:
     }
 
     void setJSFiles(QStringList& jsFiles);
+    void setEarlyJSFiles(const QStringList& jsFiles);
 
-public slots:
-    void populateJavaScriptWindowObject() {
-        m_view->page()->mainFrame()->addToJavaScriptWindowObject("vdom_external_call", this);
+    /* Let re-hunts of the file transport send <dump>.delta files
+     * (see dumpdelta.h) instead of whole dumps. */
+    void setDeltaDumps(bool enabled) {
+        m_deltaDumps = enabled;
     }
 
+public slots:
+    void populateJavaScriptWindowObject();
+    void preparePage(WebPage* page);
+
+    /* synchronous and text only; new scripts should use the
+     * asynchronous window.vdom_fs (see filebridge.h) */
     QString readFile(const QString& filePath) {
-        qDebug() << "read file: " << filePath;
+        VDOM_LOG(Bridge, Debug, "read file: " + filePath);
         QFile file(filePath);
         if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
             return "";
 
         QTextStream in(&file);
         QString content = in.readAll();
-
-        qDebug() << "read file: " << content;
         file.close();
 
         return content;
     }
 
     bool writeFile(const QString& filePath, const QString& content) {
-        qDebug() << "write file: " << filePath;
+        VDOM_LOG(Bridge, Debug, "write file: " + filePath);
         QFile file(filePath);
         if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
             return false;
@@ -69,15 +88,10 @@ public slots:
         return true;
     }
 
-    void processFinished(int exitCode, QProcess::ExitStatus) {
-        qDebug() << "processFinished: " << m_processCallback << exitCode;
-        m_view->page()->mainFrame()->evaluateJavaScript(m_processCallback + "(" + QString::number(exitCode) + ");");
-    }
-
+    /* the named global function gets the exit code; runs in the
+     * ProcessPool like window.vdom_proc, which streams the output */
     bool callProcess(const QString& process,  const QStringList& list, const QString& callback) {
-        m_processCallback = callback;
-        qDebug() << "run process: " << process << " args: " << list;
-        m_callProc->start(process, list);
+        m_processCallbacks.insert(m_processPool->start(process, list), callback);
         return true;
     }
 
@@ -89,23 +103,52 @@ protected slots:
 
     void iterPrev();
     void iterNext();
+    void iterJumpTo();
+    void iterListGrown(int count);
 
     void huntOnly();
 
+    void prefetchedPageLoaded(WebPage* page);
+    void traceLoadStarted();
+
     void hunterStarted() {
         statusBar()->showMessage("Hunter " + m_hunterPath + " started.");
     }
 
     void hunterFinished(int exitCode, QProcess::ExitStatus);
 
-    void emitHunterStdout() {
-        m_itemInfoEdit->append(QString::fromUtf8(m_hunter.readAllStandardOutput()));
-    }
+    void emitHunterStdout();
 
     void emitHunterStderr() {
-        m_itemInfoEdit->append(QString::fromUtf8(m_hunter.readAllStandardError()));
+        m_hunterLog->append(QString::fromUtf8(m_hunter.readAllStandardError()));
+    }
+
+    void processFinished(int id, int exitCode, const QString& error);
+
+    void emitHunterPoolStderr(const QString& text) {
+        m_hunterLog->append(text);
     }
 
+    void hunterPoolResult(int jobId, const QByteArray& result);
+    void hunterPoolFailed(int jobId, const QString& error);
+
+    void hunterGroupsParsed(int id, int offset, const QVariantList& groups);
+    void hunterResultParsed(int id, const QVariantMap& root);
+    void hunterResultFailed(int id, const QString& error);
+
+    void saveImage() {
+        saveImage(false);
+    }
+
+    void saveAnnotatedImage() {
+        saveImage(true);
+    }
+
+    void imageTileWritten(const QString& path, const QString& error);
+
+    void dumpWritten(int id, const QByteArray& data, const QByteArray& sha1,
+                     const QString& error);
+
     void loadUrl(const QUrl& url);
 
     void updateUrl(const QUrl& url) {
@@ -221,11 +264,36 @@ protected slots:
 private:
 
     void initIterator();
+    void loadIterPage(int ind);
+    QString iterUrl(int ind) const;
+    void updateIterLabel();
+
+    void showPrefetchedPage(PrefetchedPage* prefetched);
+    void schedulePrefetch();
+    void configurePrefetcher();
 
     QVariant evalJS(const QString& js);
+    void injectJS(QWebFrame* frame, const QStringList& jsFiles);
+
+    /* takes the text dump, encoded as configured on the way out */
+    void runHunter(const QByteArray& text, bool rehunt = false);
+    /* hashed: the text dump, if text is not */
+    void submitDump(const QByteArray& text, const QString& path,
+                    const QByteArray& hashed = QByteArray());
+    void startHunt(const QByteArray& dumpSha1, const QByteArray& vdom);
+    void launchHunter(const QByteArray& vdom);
+    void updateCacheLabel();
+    void reportError(const QString& msg);
+    void resetHunt();
+    /* boxes: burn in the boxes of the last hunt */
+    void saveImage(bool boxes);
+
+    void traceEndPage(const char* outcome = "done");
 
     void addUrlToList();
     void initHunterConfig();
+    void configureHunterPool();
+    void startHunterLog();
 
     void initIteratorConfig();
 
@@ -237,6 +305,8 @@ private:
 
     void createCentralWidget();
     void createWebView();
+    void attachPage(WebPage* page, QWebVDom* vdom);
+    void installPageActions();
     void createSidebar();
     void createToolBar();
 
@@ -253,13 +323,25 @@ private:
     void writeSettings();
     void readSettings();
 
-    void annotateWebPage(QVariantList& groups);
+    void installAnnotationLib();
+    void beginAnnotation();
+    void annotateGroups(const QVariantList& groups, int offset);
+    void endAnnotation();
+
+    void parseHunterResult(const QByteArray& data, const QString& source);
+    void parseHunterResultFile(const QString& path);
 
     QTextEdit* m_itemInfoEdit;
     QTextEdit* m_pageInfoEdit;
+    LogConsole* m_hunterLog;
 
     WebView *m_view;
     LineEdit *m_urlEdit;
+    QToolBar *m_navBar;
+    QAction *m_urlEditAction;
+    QMenu *m_editMenu;
+    QMenu *m_viewMenu;
+    QAction *m_viewMenuSeparator;
     QSplitter *m_sidebar;
     QProgressBar *m_progress;
     HunterConfigDialog* m_hunterConfig;
@@ -267,8 +349,6 @@ private:
 
     IteratorConfigDialog* m_iteratorConfig;
 
-    QStringList m_urlList;
-    QStringListModel m_urlCompleterModel;
     QSettings* m_settings;
 
     bool m_enableJavascript;
@@ -281,12 +361,27 @@ private:
     bool m_hunterEnabled;
     QString m_hunterPath;
     QString m_vdomPath;
+    int m_hunterTransport;
+    int m_hunterDumpFormat;
+    int m_hunterPoolSize;
+    int m_hunterDeadline;
+    int m_hunterMemoryLimit;
+    int m_hunterLogLines;
+    QString m_hunterLogDir;
 
     bool m_iteratorEnabled;
     QString m_urlListFile;
+    int m_prefetchPages;
+    int m_prefetchMemory;
 
     QWebVDom* m_webvdom;
     QProcess m_hunter;
+    HunterFrameReader m_hunterFrames;
+    QByteArray m_hunterResult;
+    bool m_hunterResultReady;
+    HunterPool* m_hunterPool;
+    int m_hunterJobId;
+    QString m_hunterError;
     QPushButton* m_huntButton;
 
     QPushButton* m_iterPrevButton;
@@ -294,15 +389,54 @@ private:
 
     QLabel* m_iterLabel;
 
-    JSonDriver m_jsonDriver;
+    QThread* m_parserThread;
+    HunterResultParser* m_resultParser;
+    int m_resultParseId;
+    bool m_annotating;
+    /* every group of the last hunt result, for saveImage() */
+    QVariantList m_huntedGroups;
+    PageCapture* m_capture;
+    FileBridge* m_fileBridge;
+    HunterResultCache m_resultCache;
+    /* where the result of the running hunt is to be cached, empty if
+     * it is not */
+    QByteArray m_huntKey;
+    QLabel* m_cacheLabel;
+
+    bool m_deltaDumps;
+    /* encodes and writes the dumps for the hunter */
+    DumpPipeline* m_dumpPipeline;
+    /* the dump the hunter waits for, -1 for none */
+    int m_dumpJob;
+    qint64 m_writeStart;
+    QStringList m_hunterArgs;
+    /* the text of a full write of m_vdomPath under way */
+    QByteArray m_pendingFileDump;
+    /* what m_vdomPath holds, as we wrote it */
+    QByteArray m_fileDump;
+    QByteArray m_fileDumpHash;
+    QString m_fileDumpPath;
+    int m_fileDumpFormat;
+    qint64 m_fileDumpSize;
+    QDateTime m_fileDumpTime;
+
+    /* Tracer page id of the page shown, -1 when not traced */
+    int m_tracePage;
+    qint64 m_loadStart;
+    qint64 m_huntStart;
+    qint64 m_parseStart;
 
     Iterator m_iterator;
+    UrlList* m_iterUrls;
+    PagePrefetcher* m_prefetcher;
 
     QSplitter* m_mainSplitter;
     QStringList m_injectedJSFiles;
+    QStringList m_earlyJSFiles;
 
-    QString m_processCallback;
-    QProcess* m_callProc;
+    ProcessPool* m_processPool;
+    /* by ProcessPool id, for callProcess() */
+    QHash<int, QString> m_processCallbacks;
 };
 
 #endif
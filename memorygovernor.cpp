@@ -0,0 +1,97 @@
+#include "memorygovernor.h"
+#include "logger.h"
+
+#include <qwebsettings.h>
+#include <unistd.h>
+
+/* the capacities without a budget, or with one at level 0 */
+const static int DEFAULT_OBJECT_CACHE = 16 * 1024 * 1024;
+const static int DEFAULT_PAGES_IN_CACHE = 20;
+/* the object cache takes at most this share of the budget */
+const static int OBJECT_CACHE_SHARE = 8;
+const static int MAX_OBJECT_CACHE = 64 * 1024 * 1024;
+const static int MAX_LEVEL = 3;
+
+MemoryGovernor* MemoryGovernor::instance() {
+    static MemoryGovernor* governor = 0;
+    if (!governor) {
+        governor = new MemoryGovernor;
+    }
+    return governor;
+}
+
+MemoryGovernor::MemoryGovernor()
+    : m_budget(0), m_recyclePages(0), m_level(0)
+{
+    applyLevel();
+}
+
+void MemoryGovernor::setBudget(int mb) {
+    m_budget = qint64(qMax(mb, 0)) * 1024 * 1024;
+    m_level = 0;
+    applyLevel();
+}
+
+qint64 MemoryGovernor::residentBytes() {
+    /* "size resident shared ..." in pages */
+    QFile file("/proc/self/statm");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    QList<QByteArray> fields = file.readLine().split(' ');
+    bool ok = false;
+    qint64 pages = fields.value(1).toLongLong(&ok);
+    if (!ok) {
+        return -1;
+    }
+    return pages * sysconf(_SC_PAGESIZE);
+}
+
+void MemoryGovernor::applyLevel() {
+    int total = DEFAULT_OBJECT_CACHE;
+    int pages = DEFAULT_PAGES_IN_CACHE;
+    if (m_budget > 0) {
+        total = int(qMin(m_budget / OBJECT_CACHE_SHARE, qint64(MAX_OBJECT_CACHE)));
+        /* each level quarters what the caches may hold */
+        total >>= 2 * m_level;
+        pages = m_level == MAX_LEVEL ? 0 : DEFAULT_PAGES_IN_CACHE >> (2 * m_level);
+    }
+    QWebSettings::setObjectCacheCapacities(total / 8, total / 8, total);
+    QWebSettings::setMaximumPagesInCache(pages);
+}
+
+void MemoryGovernor::clearCaches() {
+    /* WebCore prunes down to the new capacities right away */
+    QWebSettings::setObjectCacheCapacities(0, 0, 0);
+    QWebSettings::setMaximumPagesInCache(0);
+    applyLevel();
+}
+
+bool MemoryGovernor::pageDone(int pagesServed) {
+    bool recycle = m_recyclePages > 0 && pagesServed >= m_recyclePages;
+    if (m_budget <= 0) {
+        return recycle;
+    }
+
+    qint64 rss = residentBytes();
+    if (rss < 0) {
+        return recycle;
+    }
+    int level = m_level;
+    if (rss > m_budget * 3 / 4 && m_level < MAX_LEVEL) {
+        m_level++;
+    } else if (rss < m_budget / 2 && m_level > 0) {
+        m_level--;
+    }
+    if (m_level != level) {
+        VDOM_LOG(General, Info, QString("memory: RSS %1 MB of %2 MB, cache level %3")
+                .arg(rss / (1024 * 1024)).arg(m_budget / (1024 * 1024)).arg(m_level));
+    }
+    if (m_level > 0) {
+        /* under pressure nothing stays cached across pages */
+        clearCaches();
+    } else if (m_level != level) {
+        applyLevel();
+    }
+    return recycle || rss > m_budget * 9 / 10;
+}
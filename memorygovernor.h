@@ -0,0 +1,58 @@
+#ifndef MEMORY_GOVERNOR_H
+#define MEMORY_GOVERNOR_H
+
+#include <QtCore>
+
+/* Keeps the process within a memory budget over long runs.
+ *
+ * pageDone() is called between two pages. It reads the resident set
+ * size and steps the WebKit object cache and back/forward page cache
+ * capacities down a pressure level when RSS is above 3/4 of the
+ * budget, flushing the dead resources, and back up once it is below
+ * 1/2. It also tells the caller when to throw away its WebPage and
+ * build a new one: after recyclePages() pages, or above 9/10 of the
+ * budget, since a WebPage that lived long enough keeps memory no
+ * cache setting gives back.
+ *
+ * Without a budget the caches stay at the fixed sizes browsing always
+ * used and only the page count triggers recycling. */
+class MemoryGovernor {
+public:
+    static MemoryGovernor* instance();
+
+    /* in MB, 0 for none */
+    void setBudget(int mb);
+
+    /* pages a WebPage serves before it is rebuilt, 0 for no limit */
+    void setRecyclePages(int pages) {
+        m_recyclePages = pages;
+    }
+
+    int recyclePages() const {
+        return m_recyclePages;
+    }
+
+    /* Account for a page done with by a WebPage that has served
+     * pagesServed pages so far. Returns whether that WebPage should be
+     * rebuilt before the next one. */
+    bool pageDone(int pagesServed);
+
+    /* Flush whatever the caches hold but nothing uses; after a WebPage
+     * was destroyed, say. */
+    void clearCaches();
+
+    /* resident set size, -1 if unknown */
+    static qint64 residentBytes();
+
+private:
+    MemoryGovernor();
+
+    void applyLevel();
+
+    qint64 m_budget;
+    int m_recyclePages;
+    /* 0: full caches ... MAX_LEVEL: none at all */
+    int m_level;
+};
+
+#endif // MEMORY_GOVERNOR_H
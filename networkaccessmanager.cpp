@@ -0,0 +1,341 @@
+#include "networkaccessmanager.h"
+#include "logger.h"
+
+NetworkAccessManager::ArchiveMode NetworkAccessManager::s_archiveMode = NoArchive;
+WebArchive* NetworkAccessManager::s_archive = 0;
+int NetworkAccessManager::s_replayLatency = 0;
+
+NetworkAccessManager::NetworkAccessManager(QObject* parent)
+    : QNetworkAccessManager(parent), m_mainFrame(0), m_awaitingDocument(false),
+      m_requests(0), m_blocked(0), m_bytes(0)
+{
+}
+
+bool NetworkAccessManager::setArchive(ArchiveMode mode, const QString& dir,
+        QString& errorString)
+{
+    s_archiveMode = NoArchive;
+    if (mode == NoArchive) {
+        return true;
+    }
+    if (!s_archive) {
+        s_archive = new WebArchive;
+    }
+    if (!s_archive->open(dir, mode == RecordArchive)) {
+        errorString = s_archive->errorString();
+        return false;
+    }
+    s_archiveMode = mode;
+    return true;
+}
+
+void NetworkAccessManager::startPage() {
+    if (m_blocked > 0) {
+        VDOM_LOG(Network, Info, QString("Blocked %1 of %2 requests of %3")
+                .arg(m_blocked).arg(m_requests + m_blocked).arg(m_pageUrl.toString()));
+    }
+    m_pageUrl = m_nextPageUrl;
+    m_awaitingDocument = true;
+    m_requests = 0;
+    m_blocked = 0;
+    m_bytes = 0;
+    /* whatever is still running belongs to the old page */
+    m_received.clear();
+}
+
+QNetworkReply* NetworkAccessManager::createRequest(Operation op,
+        const QNetworkRequest& request, QIODevice* outgoingData)
+{
+    QString scheme = request.url().scheme().toLower();
+    bool http = scheme == "http" || scheme == "https";
+
+    bool document = isDocumentRequest(request);
+    if (document) {
+        /* third-party checks are relative to where it really is */
+        m_pageUrl = request.url();
+        m_awaitingDocument = false;
+    }
+
+    RequestFilter* filter = RequestFilter::instance();
+    bool budgeted = false;
+    if (http && !document && filter->isActive() &&
+            !filter->isAllowed(request.url())) {
+        QString reason = filter->check(request, m_pageUrl);
+        if (reason.isNull() && filter->maxRequests() > 0 &&
+                m_requests >= filter->maxRequests()) {
+            reason = QString("over the budget of %1 requests").arg(filter->maxRequests());
+        }
+        if (reason.isNull() && filter->maxBytes() > 0 && m_bytes >= filter->maxBytes()) {
+            reason = QString("over the budget of %1 bytes").arg(filter->maxBytes());
+        }
+        if (!reason.isNull()) {
+            return blocked(op, request, reason);
+        }
+        budgeted = filter->maxBytes() > 0;
+    }
+    if (!document) {
+        m_requests++;
+    }
+
+    QNetworkReply* reply;
+    if (s_archiveMode == NoArchive || !http) {
+        reply = QNetworkAccessManager::createRequest(op, request, outgoingData);
+    } else if (s_archiveMode == ReplayArchive) {
+        /* only GETs are archived; everything else fails as well */
+        WebArchive::Response response;
+        if (op != GetOperation || !s_archive->find(request.url(), response)) {
+            return new ErrorReply(request, op, QNetworkReply::ContentNotFoundError,
+                    QString("%1 is not in the archive").arg(request.url().toString()),
+                    this);
+        }
+        reply = new ArchiveReply(request, op, response, s_replayLatency, this);
+    } else {
+        reply = QNetworkAccessManager::createRequest(op, request, outgoingData);
+        if (op == GetOperation) {
+            reply = new RecordingReply(reply, s_archive, this);
+        }
+    }
+
+    m_running.insert(reply);
+    connect(reply, SIGNAL(finished()), this, SLOT(replyDone()));
+    connect(reply, SIGNAL(destroyed(QObject*)), this, SLOT(replyDone(QObject*)));
+    emit runningRequestsChanged(m_running.count());
+
+    if (document) {
+        connect(reply, SIGNAL(metaDataChanged()), this, SLOT(documentMetaDataChanged()));
+    }
+    if (budgeted) {
+        m_received.insert(reply, 0);
+        connect(reply, SIGNAL(downloadProgress(qint64, qint64)),
+                this, SLOT(replyProgress(qint64, qint64)));
+        connect(reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+    }
+    return reply;
+}
+
+QNetworkReply* NetworkAccessManager::blocked(Operation op,
+        const QNetworkRequest& request, const QString& reason)
+{
+    m_blocked++;
+    return new ErrorReply(request, op, QNetworkReply::ContentAccessDenied,
+            QString("Blocked %1: %2").arg(request.url().toString()).arg(reason),
+            this);
+}
+
+bool NetworkAccessManager::isDocumentRequest(const QNetworkRequest& request) const {
+    if (!m_awaitingDocument) {
+        return false;
+    }
+#if QT_VERSION >= 0x040700
+    return request.originatingObject() == m_mainFrame;
+#else
+    Q_UNUSED(request);
+    return true;
+#endif
+}
+
+void NetworkAccessManager::documentMetaDataChanged() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (reply && reply->attribute(QNetworkRequest::RedirectionTargetAttribute).isValid()) {
+        /* WebKit follows it with a request of its own */
+        m_awaitingDocument = true;
+    }
+}
+
+void NetworkAccessManager::replyProgress(qint64 received, qint64) {
+    QHash<QObject*, qint64>::iterator it = m_received.find(sender());
+    if (it == m_received.end()) {
+        return;
+    }
+    m_bytes += received - it.value();
+    it.value() = received;
+    if (m_bytes > RequestFilter::instance()->maxBytes()) {
+        QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+        m_received.erase(it);
+        m_blocked++;
+        VDOM_LOG(Network, Info, QString("Aborting %1: page over its byte budget")
+                .arg(reply->url().toString()));
+        reply->abort();
+    }
+}
+
+void NetworkAccessManager::replyFinished() {
+    m_received.remove(sender());
+}
+
+/* finished, or deleted before it could finish */
+void NetworkAccessManager::replyDone(QObject* reply) {
+    if (!reply) {
+        reply = sender();
+    }
+    if (m_running.remove(reply)) {
+        emit runningRequestsChanged(m_running.count());
+    }
+}
+
+RecordingReply::RecordingReply(QNetworkReply* reply, WebArchive* archive, QObject* parent)
+    : QNetworkReply(parent), m_reply(reply), m_archive(archive)
+{
+    m_reply->setParent(this);
+    setOperation(m_reply->operation());
+    setRequest(m_reply->request());
+    setUrl(m_reply->url());
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    connect(m_reply, SIGNAL(metaDataChanged()), this, SLOT(replyMetaDataChanged()));
+    connect(m_reply, SIGNAL(readyRead()), this, SLOT(replyReadyRead()));
+    connect(m_reply, SIGNAL(error(QNetworkReply::NetworkError)),
+            this, SLOT(replyError(QNetworkReply::NetworkError)));
+    connect(m_reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+    connect(m_reply, SIGNAL(uploadProgress(qint64, qint64)),
+            this, SIGNAL(uploadProgress(qint64, qint64)));
+    connect(m_reply, SIGNAL(downloadProgress(qint64, qint64)),
+            this, SIGNAL(downloadProgress(qint64, qint64)));
+}
+
+void RecordingReply::abort() {
+    m_reply->abort();
+}
+
+qint64 RecordingReply::bytesAvailable() const {
+    return m_buffer.size() + QNetworkReply::bytesAvailable();
+}
+
+qint64 RecordingReply::readData(char* data, qint64 maxSize) {
+    qint64 n = qMin(maxSize, qint64(m_buffer.size()));
+    memcpy(data, m_buffer.constData(), n);
+    m_buffer.remove(0, n);
+    return n;
+}
+
+void RecordingReply::replyMetaDataChanged() {
+    QList<QByteArray> names = m_reply->rawHeaderList();
+    for (int i = 0; i < names.count(); i++) {
+        setRawHeader(names[i], m_reply->rawHeader(names[i]));
+    }
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute,
+            m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute));
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute,
+            m_reply->attribute(QNetworkRequest::HttpReasonPhraseAttribute));
+    setAttribute(QNetworkRequest::RedirectionTargetAttribute,
+            m_reply->attribute(QNetworkRequest::RedirectionTargetAttribute));
+    emit metaDataChanged();
+}
+
+void RecordingReply::replyReadyRead() {
+    QByteArray data = m_reply->readAll();
+    m_buffer += data;
+    m_body += data;
+    emit readyRead();
+}
+
+void RecordingReply::replyError(QNetworkReply::NetworkError code) {
+    setError(code, m_reply->errorString());
+    emit error(code);
+}
+
+void RecordingReply::replyFinished() {
+    QVariant status = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    if (m_reply->error() == QNetworkReply::NoError && status.isValid()) {
+        WebArchive::Response response;
+        response.status = status.toInt();
+        response.reason = m_reply->attribute(
+                QNetworkRequest::HttpReasonPhraseAttribute).toString().toUtf8();
+        QList<QByteArray> names = m_reply->rawHeaderList();
+        for (int i = 0; i < names.count(); i++) {
+            /* the body we got is already decoded and unchunked */
+            QByteArray name = names[i].toLower();
+            if (name == "content-encoding" || name == "transfer-encoding" ||
+                    name == "content-length")
+                continue;
+            response.headers.append(qMakePair(names[i], m_reply->rawHeader(names[i])));
+        }
+        response.body = m_body;
+        if (!m_archive->store(url(), response)) {
+            VDOM_LOG(Network, Warning, "Failed to record " + url().toString());
+        }
+    }
+    m_body.clear();
+    emit finished();
+}
+
+ArchiveReply::ArchiveReply(const QNetworkRequest& request, Operation op,
+        const WebArchive::Response& response,
+        int latency, QObject* parent)
+    : QNetworkReply(parent), m_body(response.body), m_offset(0),
+      m_aborted(false)
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(op);
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    for (int i = 0; i < response.headers.count(); i++) {
+        setRawHeader(response.headers[i].first, response.headers[i].second);
+    }
+    setRawHeader("Content-Length", QByteArray::number(m_body.size()));
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, response.status);
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute,
+            QString::fromUtf8(response.reason));
+    QByteArray location = rawHeader("Location");
+    if (response.status >= 300 && response.status < 400 && !location.isEmpty()) {
+        setAttribute(QNetworkRequest::RedirectionTargetAttribute,
+                QUrl::fromEncoded(location));
+    }
+
+    /* like a real reply, never deliver from within createRequest() */
+    QTimer::singleShot(qMax(latency, 0), this, SLOT(deliver()));
+}
+
+void ArchiveReply::abort() {
+    if (m_aborted) {
+        return;
+    }
+    m_aborted = true;
+    setError(OperationCanceledError, "Operation canceled");
+    emit error(OperationCanceledError);
+    emit finished();
+}
+
+qint64 ArchiveReply::bytesAvailable() const {
+    return m_body.size() - m_offset + QNetworkReply::bytesAvailable();
+}
+
+qint64 ArchiveReply::readData(char* data, qint64 maxSize) {
+    if (m_offset >= m_body.size()) {
+        return -1;
+    }
+    qint64 n = qMin(maxSize, qint64(m_body.size()) - m_offset);
+    memcpy(data, m_body.constData() + m_offset, n);
+    m_offset += n;
+    return n;
+}
+
+void ArchiveReply::deliver() {
+    if (m_aborted) {
+        return;
+    }
+    emit metaDataChanged();
+    if (!m_body.isEmpty()) {
+        emit downloadProgress(m_body.size(), m_body.size());
+        emit readyRead();
+    }
+    emit finished();
+}
+
+ErrorReply::ErrorReply(const QNetworkRequest& request, Operation op,
+        NetworkError error, const QString& errorString, QObject* parent)
+    : QNetworkReply(parent)
+{
+    setRequest(request);
+    setUrl(request.url());
+    setOperation(op);
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    setError(error, errorString);
+    QTimer::singleShot(0, this, SLOT(deliver()));
+}
+
+void ErrorReply::deliver() {
+    emit error(QNetworkReply::error());
+    emit finished();
+}
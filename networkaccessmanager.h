@@ -0,0 +1,179 @@
+#ifndef NETWORK_ACCESS_MANAGER_H
+#define NETWORK_ACCESS_MANAGER_H
+
+#include <QtNetwork>
+
+#include "webarchive.h"
+#include "requestfilter.h"
+
+/* The network access manager of a WebPage.
+ *
+ * By default requests go to the network as usual. In record mode
+ * every GET response is also stored in a WebArchive; in replay mode
+ * GET requests are answered from the archive only, with the recorded
+ * status and headers, optionally after an emulated latency. Anything
+ * not in the archive fails with ContentNotFoundError instead of
+ * touching the network, so a replayed run is fully repeatable. The
+ * archive is shared by the managers of all pages.
+ *
+ * Requests rejected by the RequestFilter, or beyond the request
+ * budget of the page, fail with ContentAccessDenied; downloads are
+ * aborted once the page exceeds its byte budget. The request for the
+ * main frame's document itself, redirects included, is never blocked
+ * nor counted. */
+class NetworkAccessManager : public QNetworkAccessManager {
+    Q_OBJECT
+public:
+    enum ArchiveMode {
+        NoArchive,
+        RecordArchive,
+        ReplayArchive
+    };
+
+    NetworkAccessManager(QObject* parent = 0);
+
+    /* for all managers */
+    static bool setArchive(ArchiveMode mode, const QString& dir, QString& errorString);
+
+    static ArchiveMode archiveMode() {
+        return s_archiveMode;
+    }
+
+    /* delay in ms before a replayed response starts */
+    static void setReplayLatency(int ms) {
+        s_replayLatency = ms;
+    }
+
+    /* The main frame accepted a navigation to url. Nothing is reset
+     * until the document actually starts loading. */
+    void setNextPage(const QUrl& url) {
+        m_nextPageUrl = url;
+    }
+
+    /* the frame whose document requests are exempt (needs Qt 4.7 to
+     * tell; before, the first request of a load is the document) */
+    void setMainFrame(QObject* frame) {
+        m_mainFrame = frame;
+    }
+
+    /* requests of the page still running */
+    int runningRequests() const {
+        return m_running.count();
+    }
+
+signals:
+    void runningRequestsChanged(int count);
+
+public slots:
+    /* The main frame starts loading a new document: forget the budget
+     * spent on the previous one. */
+    void startPage();
+
+protected:
+    virtual QNetworkReply* createRequest(Operation op,
+            const QNetworkRequest& request, QIODevice* outgoingData = 0);
+
+private slots:
+    void documentMetaDataChanged();
+    void replyProgress(qint64 received, qint64 total);
+    void replyFinished();
+    void replyDone(QObject* reply = 0);
+
+private:
+    QNetworkReply* blocked(Operation op, const QNetworkRequest& request,
+            const QString& reason);
+    bool isDocumentRequest(const QNetworkRequest& request) const;
+
+    static ArchiveMode s_archiveMode;
+    static WebArchive* s_archive;
+    static int s_replayLatency;
+
+    QUrl m_pageUrl;
+    QUrl m_nextPageUrl;
+    QObject* m_mainFrame;
+    /* the next request of the main frame is its document */
+    bool m_awaitingDocument;
+    int m_requests;
+    int m_blocked;
+    qint64 m_bytes;
+    /* bytes counted so far per running reply */
+    QHash<QObject*, qint64> m_received;
+    QSet<QObject*> m_running;
+};
+
+/* Passes a network reply through while copying its body, and stores
+ * the complete response in the archive once it has finished. */
+class RecordingReply : public QNetworkReply {
+    Q_OBJECT
+public:
+    RecordingReply(QNetworkReply* reply, WebArchive* archive, QObject* parent = 0);
+
+    virtual void abort();
+    virtual qint64 bytesAvailable() const;
+    virtual bool isSequential() const {
+        return true;
+    }
+
+protected:
+    virtual qint64 readData(char* data, qint64 maxSize);
+
+private slots:
+    void replyMetaDataChanged();
+    void replyReadyRead();
+    void replyError(QNetworkReply::NetworkError code);
+    void replyFinished();
+
+private:
+    QNetworkReply* m_reply;
+    WebArchive* m_archive;
+    /* not yet read by our consumer */
+    QByteArray m_buffer;
+    QByteArray m_body;
+};
+
+/* A reply served from the archive. */
+class ArchiveReply : public QNetworkReply {
+    Q_OBJECT
+public:
+    ArchiveReply(const QNetworkRequest& request, Operation op,
+            const WebArchive::Response& response,
+            int latency, QObject* parent = 0);
+
+    virtual void abort();
+    virtual qint64 bytesAvailable() const;
+    virtual bool isSequential() const {
+        return true;
+    }
+
+protected:
+    virtual qint64 readData(char* data, qint64 maxSize);
+
+private slots:
+    void deliver();
+
+private:
+    QByteArray m_body;
+    qint64 m_offset;
+    bool m_aborted;
+};
+
+/* A reply which fails right away, without touching the network. */
+class ErrorReply : public QNetworkReply {
+    Q_OBJECT
+public:
+    ErrorReply(const QNetworkRequest& request, Operation op,
+            NetworkError error, const QString& errorString,
+            QObject* parent = 0);
+
+    virtual void abort() {}
+
+protected:
+    virtual qint64 readData(char*, qint64) {
+        return -1;
+    }
+
+private slots:
+    void deliver();
+};
+
+#endif // NETWORK_ACCESS_MANAGER_H
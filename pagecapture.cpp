@@ -0,0 +1,142 @@
+#include "pagecapture.h"
+
+#include <qwebframe.h>
+#include <qwebpage.h>
+#include <QtConcurrentRun>
+
+/* tiles painted but not yet written; each holds width x tileHeight
+ * 32-bit pixels */
+const static int MAX_PENDING = 8;
+
+const static int DEFAULT_TILE_HEIGHT = 2048;
+const static int DEFAULT_MAX_HEIGHT = 32768;
+
+/* wider pages are cut off at the right */
+const static int MAX_WIDTH = 4096;
+
+/* runs on the pool; returns an error message, empty on success */
+static QString encodeTile(const QImage& image, const QString& path,
+                          const QByteArray& format, int quality) {
+    QImageWriter writer(path, format);
+    writer.setQuality(quality);
+    if (!writer.write(image)) {
+        return QString("failed to write %1: %2").arg(path).arg(writer.errorString());
+    }
+    return QString();
+}
+
+PageCapture::PageCapture(QObject* parent)
+    : QObject(parent)
+    , m_format("png")
+    , m_quality(-1)
+    , m_tileHeight(DEFAULT_TILE_HEIGHT)
+    , m_maxHeight(DEFAULT_MAX_HEIGHT)
+{
+}
+
+PageCapture::~PageCapture() {
+    waitForFinished();
+}
+
+int PageCapture::capture(QWebFrame* frame, const QString& basePath,
+                         const QVariantList& groups) {
+    QWebPage* page = frame->page();
+    QSize viewport = page->viewportSize();
+    QPoint scroll = frame->scrollPosition();
+
+    /* lay the page out at its full height so that everything gets
+     * painted, not just what is scrolled into view */
+    int width = qBound(1, viewport.width(), MAX_WIDTH);
+    int height = qBound(1, frame->contentsSize().height(), m_maxHeight);
+    page->setViewportSize(QSize(width, height));
+    frame->setScrollPosition(QPoint(0, 0));
+    QSize contents = frame->contentsSize();
+    width = qBound(1, contents.width(), MAX_WIDTH);
+    height = qBound(1, contents.height(), m_maxHeight);
+
+    int tiles = 0;
+    for (int y = 0; y < height; y += m_tileHeight, tiles++) {
+        QRect rect(0, y, width, qMin(m_tileHeight, height - y));
+        QImage image(rect.size(), QImage::Format_RGB32);
+        image.fill(0xffffffff);
+        QPainter painter(&image);
+        painter.translate(-rect.topLeft());
+        frame->render(&painter, QRegion(rect));
+        if (!groups.isEmpty()) {
+            drawBoxes(&painter, groups);
+        }
+        painter.end();
+
+        while (m_pending.count() >= MAX_PENDING) {
+            QFutureWatcher<QString>* oldest = m_pending.first();
+            oldest->waitForFinished();
+            finish(oldest);
+        }
+        QString path = QString("%1.%2.%3").arg(basePath).arg(tiles)
+            .arg(QString::fromLatin1(m_format));
+        QFutureWatcher<QString>* watcher = new QFutureWatcher<QString>(this);
+        watcher->setProperty("path", path);
+        connect(watcher, SIGNAL(finished()), this, SLOT(tileEncoded()));
+        watcher->setFuture(QtConcurrent::run(encodeTile, image, path,
+                                             m_format, m_quality));
+        m_pending.append(watcher);
+    }
+
+    page->setViewportSize(viewport);
+    frame->setScrollPosition(scroll);
+    return tiles;
+}
+
+void PageCapture::drawBoxes(QPainter* painter, const QVariantList& groups) {
+    painter->setBrush(Qt::NoBrush);
+    for (int g = 0; g < groups.count(); g++) {
+        QVariantList group = groups[g].toList();
+        for (int i = 0; i < group.count(); i++) {
+            QVariantMap box = group[i].toMap();
+            if (box.isEmpty())
+                continue;
+            QColor color(box.value("borderColor", "red").toString());
+            if (!color.isValid())
+                color = Qt::red;
+            int border = box.value("borderWidth", 2).toInt();
+            if (border <= 0)
+                continue;
+            QPen pen(color, border);
+            pen.setJoinStyle(Qt::MiterJoin);
+            painter->setPen(pen);
+            /* like the CSS boxes of the annotation layer: w x h
+             * inside a border starting at x, y */
+            painter->drawRect(QRectF(box["x"].toInt() + border / 2.0,
+                                     box["y"].toInt() + border / 2.0,
+                                     box["w"].toInt() + border,
+                                     box["h"].toInt() + border));
+        }
+    }
+}
+
+void PageCapture::waitForFinished() {
+    while (!m_pending.isEmpty()) {
+        QFutureWatcher<QString>* oldest = m_pending.first();
+        oldest->waitForFinished();
+        finish(oldest);
+    }
+}
+
+void PageCapture::tileEncoded() {
+    QFutureWatcher<QString>* watcher =
+        static_cast<QFutureWatcher<QString>*>(sender());
+    /* may have been waited for already */
+    if (m_pending.contains(watcher)) {
+        finish(watcher);
+    }
+}
+
+void PageCapture::finish(QFutureWatcher<QString>* watcher) {
+    m_pending.removeOne(watcher);
+    watcher->disconnect(this);
+    watcher->deleteLater();
+    emit tileWritten(watcher->property("path").toString(), watcher->result());
+    if (m_pending.isEmpty()) {
+        emit idle();
+    }
+}
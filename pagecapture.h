@@ -0,0 +1,94 @@
+#ifndef PAGE_CAPTURE_H
+#define PAGE_CAPTURE_H
+
+#include <QtGui>
+#include <QFutureWatcher>
+
+class QWebFrame;
+
+/* Renders a frame to image files for reviewing what was extracted.
+ *
+ * capture() lays the page out at its full height (up to maxHeight())
+ * and paints it into tiles of at most tileHeight() rows, so a very
+ * tall page never needs one giant image. Painting has to happen on
+ * the GUI thread; encoding each tile to PNG or JPEG and writing it is
+ * handed to the QtConcurrent pool, so the caller can go on loading
+ * the next page. At most MAX_PENDING tiles are waiting to be encoded
+ * at a time; beyond that capture() waits for the oldest one.
+ *
+ * The tiles of a capture to <base> are written as <base>.0.<format>,
+ * <base>.1.<format>, ... from the top. */
+class PageCapture : public QObject {
+    Q_OBJECT
+public:
+    PageCapture(QObject* parent = 0);
+    ~PageCapture();
+
+    /* "png" or "jpg" */
+    void setFormat(const QString& format) {
+        m_format = format.toLower().toLatin1();
+    }
+
+    const QByteArray& format() const {
+        return m_format;
+    }
+
+    /* JPEG quality, 0..100, -1 for the default */
+    void setQuality(int quality) {
+        m_quality = quality;
+    }
+
+    void setTileHeight(int height) {
+        m_tileHeight = qMax(height, 1);
+    }
+
+    int tileHeight() const {
+        return m_tileHeight;
+    }
+
+    /* pages taller than this are cut off */
+    void setMaxHeight(int height) {
+        m_maxHeight = qMax(height, 1);
+    }
+
+    int maxHeight() const {
+        return m_maxHeight;
+    }
+
+    /* Paint frame and queue its tiles for encoding; returns the number
+     * of tiles. groups is optional and takes the "groups" of a hunter
+     * result: lists of boxes {x, y, w, h, borderColor, borderWidth}
+     * in page coordinates, which are burned into the tiles. */
+    int capture(QWebFrame* frame, const QString& basePath,
+                const QVariantList& groups = QVariantList());
+
+    /* tiles still to be written */
+    int pending() const {
+        return m_pending.count();
+    }
+
+    /* block until every tile queued so far is written */
+    void waitForFinished();
+
+signals:
+    /* error is empty if the tile was written */
+    void tileWritten(const QString& path, const QString& error);
+    /* no tiles are pending any more */
+    void idle();
+
+private slots:
+    void tileEncoded();
+
+private:
+    void drawBoxes(QPainter* painter, const QVariantList& groups);
+    void finish(QFutureWatcher<QString>* watcher);
+
+    QByteArray m_format;
+    int m_quality;
+    int m_tileHeight;
+    int m_maxHeight;
+
+    QList<QFutureWatcher<QString>*> m_pending;
+};
+
+#endif // PAGE_CAPTURE_H
@@ -0,0 +1,254 @@
+#include "pageprefetcher.h"
+#include "logger.h"
+
+PagePrefetcher::PagePrefetcher(QObject* parent)
+    : QObject(parent), m_depth(0), m_memoryLimit(0), m_hunterEnabled(false),
+      m_dumpFormat(VdomBinary::TextDump)
+{
+}
+
+PagePrefetcher::~PagePrefetcher() {
+    clear();
+}
+
+void PagePrefetcher::setDepth(int pages) {
+    m_depth = qMax(pages, 0);
+    if (m_depth == 0) {
+        clear();
+    }
+}
+
+void PagePrefetcher::setMemoryLimit(int mb) {
+    m_memoryLimit = qint64(qMax(mb, 0)) * 1024 * 1024;
+}
+
+void PagePrefetcher::setHunter(bool enabled, HunterPool* pool) {
+    m_hunterEnabled = enabled;
+    if (m_pool == pool) {
+        return;
+    }
+    if (m_pool) {
+        disconnect(m_pool, 0, this, 0);
+    }
+    m_pool = pool;
+    if (m_pool) {
+        connect(m_pool, SIGNAL(resultReady(int, const QByteArray&)),
+                this, SLOT(hunterResultReady(int, const QByteArray&)));
+        connect(m_pool, SIGNAL(failed(int, const QString&)),
+                this, SLOT(hunterFailed(int, const QString&)));
+    }
+}
+
+void PagePrefetcher::prefetch(const QList<int>& indexes, const QList<QUrl>& urls) {
+    m_wanted = indexes.mid(0, m_depth);
+    m_wantedUrls = urls.mid(0, m_depth);
+
+    /* keep the pages still ahead of us, drop the ones we passed */
+    for (int i = m_pages.count() - 1; i >= 0; i--) {
+        PrefetchedPage* page = m_pages[i];
+        int pos = m_wanted.indexOf(page->index);
+        if (pos < 0 || m_wantedUrls[pos] != page->url) {
+            m_pages.removeAt(i);
+            discard(page);
+        }
+    }
+    sortPages();
+    startNext();
+}
+
+PrefetchedPage* PagePrefetcher::take(int index) {
+    int i = findIndex(index);
+    if (i < 0) {
+        return 0;
+    }
+    PrefetchedPage* page = m_pages.takeAt(i);
+    int pos = m_wanted.indexOf(index);
+    m_wanted.removeAt(pos);
+    m_wantedUrls.removeAt(pos);
+    disconnect(page->page, 0, this, 0);
+    disconnect(page->page->readiness(), 0, this, 0);
+    /* a pending pool job now belongs to the caller */
+    return page;
+}
+
+void PagePrefetcher::clear() {
+    while (!m_pages.isEmpty()) {
+        discard(m_pages.takeLast());
+    }
+    m_wanted.clear();
+    m_wantedUrls.clear();
+}
+
+qint64 PagePrefetcher::memoryUsed() const {
+    qint64 used = 0;
+    for (int i = 0; i < m_pages.count(); i++) {
+        const PrefetchedPage* page = m_pages[i];
+        used += page->page->totalBytes();
+        used += page->dump.size() + page->hunterResult.size();
+    }
+    return used;
+}
+
+void PagePrefetcher::loadFinished(bool ok) {
+    /* sent by the page's ReadinessMonitor */
+    int i = findPage(sender()->parent());
+    if (i < 0) {
+        return;
+    }
+    PrefetchedPage* page = m_pages[i];
+    if (!ok) {
+        /* leave it to a regular load once the user gets there */
+        int pos = m_wanted.indexOf(page->index);
+        m_wanted.removeAt(pos);
+        m_wantedUrls.removeAt(pos);
+        m_pages.removeAt(i);
+        discard(page);
+        startNext();
+        return;
+    }
+
+    page->loaded = true;
+    emit pageLoaded(page->page);
+
+    if (m_hunterEnabled) {
+        /* hidden pages are never painted, so never laid out */
+        page->page->forceLayout();
+        page->dump = page->vdom->dump();
+        page->hunterDone = false;
+        page->hunterResult.clear();
+        if (m_pool) {
+            m_pool->cancel(page->hunterJobId);
+            page->hunterJobId = m_pool->submit(
+                    VdomBinary::encode(page->dump, m_dumpFormat));
+        }
+    }
+
+    enforceLimit();
+    startNext();
+}
+
+void PagePrefetcher::hunterResultReady(int jobId, const QByteArray& result) {
+    int i = findJob(jobId);
+    if (i < 0) {
+        return;
+    }
+    PrefetchedPage* page = m_pages[i];
+    page->hunterJobId = -1;
+    page->hunterDone = true;
+    page->hunterResult = result;
+    enforceLimit();
+}
+
+void PagePrefetcher::hunterFailed(int jobId, const QString& error) {
+    int i = findJob(jobId);
+    if (i < 0) {
+        return;
+    }
+    VDOM_LOG(Hunter, Warning, QString("Prefetched page %1 not hunted: %2")
+            .arg(m_pages[i]->url.toString()).arg(error));
+    /* it is hunted the regular way when shown */
+    m_pages[i]->hunterJobId = -1;
+}
+
+void PagePrefetcher::startNext() {
+    for (int i = 0; i < m_pages.count(); i++) {
+        if (!m_pages[i]->loaded)
+            return;
+    }
+    if (memoryUsed() >= m_memoryLimit) {
+        return;
+    }
+    for (int i = 0; i < m_wanted.count(); i++) {
+        if (findIndex(m_wanted[i]) >= 0)
+            continue;
+
+        PrefetchedPage* page = new PrefetchedPage;
+        page->index = m_wanted[i];
+        page->url = m_wantedUrls[i];
+        page->page = new WebPage(0);
+        /* no popups or plugins from pages nobody is looking at */
+        page->page->setHeadless(true);
+        if (m_viewportSize.isValid()) {
+            page->page->setViewportSize(m_viewportSize);
+        }
+        page->vdom = new QWebVDom(page->page->mainFrame());
+        page->loaded = false;
+        page->hunterJobId = -1;
+        page->hunterDone = false;
+
+        emit pageCreated(page->page);
+        connect(page->page->readiness(), SIGNAL(ready(bool)),
+                this, SLOT(loadFinished(bool)));
+        m_pages.append(page);
+        sortPages();
+
+        page->page->mainFrame()->load(page->url);
+        return;
+    }
+}
+
+void PagePrefetcher::enforceLimit() {
+    if (memoryUsed() <= m_memoryLimit) {
+        return;
+    }
+    while (!m_pages.isEmpty() && memoryUsed() > m_memoryLimit) {
+        discard(m_pages.takeLast());
+    }
+    /* do not fetch the dropped pages again until the user moves on */
+    for (int i = m_wanted.count() - 1; i >= 0; i--) {
+        if (findIndex(m_wanted[i]) < 0) {
+            m_wanted.removeAt(i);
+            m_wantedUrls.removeAt(i);
+        }
+    }
+}
+
+void PagePrefetcher::sortPages() {
+    QList<PrefetchedPage*> sorted;
+    for (int i = 0; i < m_wanted.count(); i++) {
+        int j = findIndex(m_wanted[i]);
+        if (j >= 0)
+            sorted.append(m_pages[j]);
+    }
+    m_pages = sorted;
+}
+
+void PagePrefetcher::discard(PrefetchedPage* page) {
+    if (page->hunterJobId >= 0 && m_pool) {
+        m_pool->cancel(page->hunterJobId);
+    }
+    disconnect(page->page, 0, this, 0);
+    disconnect(page->page->readiness(), 0, this, 0);
+    page->page->triggerAction(QWebPage::Stop);
+    delete page->vdom;
+    /* we may be inside one of its signals */
+    page->page->deleteLater();
+    delete page;
+}
+
+int PagePrefetcher::findPage(QObject* page) const {
+    for (int i = 0; i < m_pages.count(); i++) {
+        if (m_pages[i]->page == page)
+            return i;
+    }
+    return -1;
+}
+
+int PagePrefetcher::findIndex(int index) const {
+    for (int i = 0; i < m_pages.count(); i++) {
+        if (m_pages[i]->index == index)
+            return i;
+    }
+    return -1;
+}
+
+int PagePrefetcher::findJob(int jobId) const {
+    if (jobId < 0) {
+        return -1;
+    }
+    for (int i = 0; i < m_pages.count(); i++) {
+        if (m_pages[i]->hunterJobId == jobId)
+            return i;
+    }
+    return -1;
+}
@@ -0,0 +1,114 @@
+#ifndef PAGE_PREFETCHER_H
+#define PAGE_PREFETCHER_H
+
+#include <qwebvdom.h> /* added to WebCore by Yahoo! China EEEE */
+#include <qwebframe.h>
+#include <QtGui>
+
+#include "webpage.h"
+#include "hunterpool.h"
+#include "vdombinary.h"
+
+/* An iterator page loaded ahead of time by the PagePrefetcher. Once
+ * taken, the caller owns the page and its dumper. */
+struct PrefetchedPage {
+    int index;
+    QUrl url;
+    WebPage* page;
+    QWebVDom* vdom;
+    bool loaded;
+    /* only filled in when the hunter is enabled */
+    QByteArray dump;
+    /* pool job still hunting the dump, -1 for none */
+    int hunterJobId;
+    bool hunterDone;
+    QByteArray hunterResult;
+};
+
+/* Loads the next iterator pages in hidden, headless WebPages while the
+ * current one is being reviewed, one at a time so they do not compete
+ * with each other for bandwidth. When the hunter is enabled the
+ * loaded pages are dumped right away and, with a hunter pool, hunted
+ * as well.
+ *
+ * The memory held by prefetched pages is estimated as the bytes they
+ * downloaded plus their dumps and results. Above memoryLimit() the
+ * pages furthest ahead are dropped and no new ones are started. */
+class PagePrefetcher : public QObject {
+    Q_OBJECT
+public:
+    PagePrefetcher(QObject* parent = 0);
+    ~PagePrefetcher();
+
+    /* pages to keep ahead of the current one, 0 to disable */
+    void setDepth(int pages);
+
+    int depth() const {
+        return m_depth;
+    }
+
+    /* in MB */
+    void setMemoryLimit(int mb);
+
+    /* Dump loaded pages for the hunter, and hunt them as well if a
+     * pool is given. */
+    void setHunter(bool enabled, HunterPool* pool);
+
+    /* the VdomBinary::DumpFormat dumps are sent to the pool in; the
+     * dump kept in PrefetchedPage is always text */
+    void setDumpFormat(int format) {
+        m_dumpFormat = format;
+    }
+
+    /* lay hidden pages out like the visible one */
+    void setViewportSize(const QSize& size) {
+        m_viewportSize = size;
+    }
+
+    /* Prefetch these iterator pages, in order of preference; pages
+     * not among them any more are dropped. */
+    void prefetch(const QList<int>& indexes, const QList<QUrl>& urls);
+
+    /* Hand over the page prefetched for the given index, 0 if there
+     * is none. A page still loading is handed over as well. */
+    PrefetchedPage* take(int index);
+
+    void clear();
+
+    qint64 memoryUsed() const;
+
+signals:
+    /* a hidden page was created; apply the browser settings to it */
+    void pageCreated(WebPage* page);
+    /* a hidden page finished loading; inject the scripts before it
+     * gets dumped */
+    void pageLoaded(WebPage* page);
+
+private slots:
+    void loadFinished(bool ok);
+    void hunterResultReady(int jobId, const QByteArray& result);
+    void hunterFailed(int jobId, const QString& error);
+
+private:
+    void startNext();
+    void enforceLimit();
+    void sortPages();
+    void discard(PrefetchedPage* page);
+    int findPage(QObject* page) const;
+    int findIndex(int index) const;
+    int findJob(int jobId) const;
+
+    int m_depth;
+    qint64 m_memoryLimit;
+    bool m_hunterEnabled;
+    int m_dumpFormat;
+    QPointer<HunterPool> m_pool;
+    QSize m_viewportSize;
+
+    QList<int> m_wanted;
+    QList<QUrl> m_wantedUrls;
+    /* in order of m_wanted */
+    QList<PrefetchedPage*> m_pages;
+};
+
+#endif // PAGE_PREFETCHER_H
@@ -0,0 +1,170 @@
+#include "processpool.h"
+
+#include "logger.h"
+
+#include <qwebframe.h>
+
+/* The page-side half of the pool; see processpool.h. */
+const static char PROCESS_LIB[] =
+    "window.vdom_proc = (function (pool) {"
+      "var calls = {};"
+      "pool.output.connect(function (id, stream, text) {"
+        "var call = calls[id];"
+        "if (call && call[stream]) call[stream](text);"
+      "});"
+      "pool.finished.connect(function (id, exitCode, error) {"
+        "var call = calls[id];"
+        "if (!call) return;"
+        "delete calls[id];"
+        "if (call.exit) call.exit(exitCode, error || null);"
+      "});"
+      "return {"
+        "run: function (program, args, handlers) {"
+          "var id = pool.start(program, args || []);"
+          "calls[id] = handlers || {};"
+          "return id;"
+        "},"
+        "kill: function (id) { return pool.kill(id); }"
+      "};"
+    "})(window.vdom_processes);";
+
+int ProcessPool::s_defaultLimit = 0;
+
+void ProcessPool::setDefaultLimit(int limit) {
+    s_defaultLimit = limit;
+}
+
+ProcessPool::ProcessPool(QObject* parent)
+    : QObject(parent)
+    , m_limit(1)
+    , m_nextId(0)
+{
+    setLimit(s_defaultLimit);
+}
+
+ProcessPool::~ProcessPool() {
+    QList<QProcess*> procs = m_running.keys();
+    for (int i = 0; i < procs.count(); i++) {
+        /* ~QProcess kills and reaps the child; we do not want to hear
+         * about it any more */
+        Running running = m_running.take(procs[i]);
+        delete running.stdoutDecoder;
+        delete running.stderrDecoder;
+        procs[i]->disconnect(this);
+        delete procs[i];
+    }
+}
+
+void ProcessPool::setLimit(int limit) {
+    m_limit = limit > 0 ? limit : qMax(QThread::idealThreadCount(), 1);
+    QMetaObject::invokeMethod(this, "startNext", Qt::QueuedConnection);
+}
+
+void ProcessPool::install(QWebFrame* frame) {
+    frame->addToJavaScriptWindowObject("vdom_processes", this);
+    frame->evaluateJavaScript(QString::fromLatin1(PROCESS_LIB) + "true");
+}
+
+int ProcessPool::start(const QString& program, const QStringList& args) {
+    Call call;
+    call.id = m_nextId++;
+    call.program = program;
+    call.args = args;
+    m_waiting.append(call);
+    /* from the event loop, so that no signal of the call can beat the
+     * caller getting its id */
+    QMetaObject::invokeMethod(this, "startNext", Qt::QueuedConnection);
+    return call.id;
+}
+
+bool ProcessPool::kill(int id) {
+    for (int i = 0; i < m_waiting.count(); i++) {
+        if (m_waiting[i].id == id) {
+            m_waiting.removeAt(i);
+            emit finished(id, -1, "killed");
+            return true;
+        }
+    }
+    QHash<QProcess*, Running>::iterator it;
+    for (it = m_running.begin(); it != m_running.end(); ++it) {
+        if (it.value().id == id) {
+            /* processFinished() reports it */
+            it.key()->kill();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ProcessPool::startNext() {
+    while (!m_waiting.isEmpty() && m_running.count() < m_limit) {
+        Call call = m_waiting.takeFirst();
+        QTextCodec* codec = QTextCodec::codecForName("UTF-8");
+        Running running;
+        running.id = call.id;
+        running.stdoutDecoder = codec->makeDecoder();
+        running.stderrDecoder = codec->makeDecoder();
+
+        QProcess* proc = new QProcess(this);
+        m_running.insert(proc, running);
+        connect(proc, SIGNAL(readyReadStandardOutput()), this, SLOT(readOutput()));
+        connect(proc, SIGNAL(readyReadStandardError()), this, SLOT(readOutput()));
+        connect(proc, SIGNAL(error(QProcess::ProcessError)),
+                this, SLOT(processError(QProcess::ProcessError)));
+        connect(proc, SIGNAL(finished(int, QProcess::ExitStatus)),
+                this, SLOT(processFinished(int, QProcess::ExitStatus)));
+        VDOM_LOG(Bridge, Debug, QString("run process: %1 %2")
+                .arg(call.program).arg(call.args.join(" ")));
+        proc->start(call.program, call.args);
+    }
+}
+
+void ProcessPool::readOutput() {
+    readOutput(static_cast<QProcess*>(sender()));
+}
+
+void ProcessPool::readOutput(QProcess* proc) {
+    if (!m_running.contains(proc))
+        return;
+    Running running = m_running[proc];
+    QString text = running.stdoutDecoder->toUnicode(proc->readAllStandardOutput());
+    if (!text.isEmpty())
+        emit output(running.id, "stdout", text);
+    /* the receiver may have killed it */
+    if (!m_running.contains(proc))
+        return;
+    text = running.stderrDecoder->toUnicode(proc->readAllStandardError());
+    if (!text.isEmpty())
+        emit output(running.id, "stderr", text);
+}
+
+void ProcessPool::processError(QProcess::ProcessError error) {
+    /* the other errors are followed by finished() */
+    if (error == QProcess::FailedToStart) {
+        QProcess* proc = static_cast<QProcess*>(sender());
+        done(proc, -1, proc->errorString());
+    }
+}
+
+void ProcessPool::processFinished(int exitCode, QProcess::ExitStatus status) {
+    QProcess* proc = static_cast<QProcess*>(sender());
+    /* pick up what came in after the last readyRead */
+    readOutput(proc);
+    if (status == QProcess::CrashExit) {
+        done(proc, -1, proc->errorString());
+    } else {
+        done(proc, exitCode, QString());
+    }
+}
+
+void ProcessPool::done(QProcess* proc, int exitCode, const QString& error) {
+    if (!m_running.contains(proc))
+        return;
+    Running running = m_running.take(proc);
+    delete running.stdoutDecoder;
+    delete running.stderrDecoder;
+    proc->disconnect(this);
+    proc->deleteLater();
+    emit finished(running.id, exitCode, error);
+    startNext();
+}
@@ -0,0 +1,87 @@
+#ifndef PROCESS_POOL_H
+#define PROCESS_POOL_H
+
+#include <QtCore>
+
+class QWebFrame;
+
+/* Runs helper programs for the scripts of a page.
+ *
+ * Every start() gets an id of its own and any number may be asked
+ * for; at most limit() of them run at a time and the rest wait in
+ * line. stdout and stderr are handed on, decoded as UTF-8, as soon as
+ * they arrive.
+ *
+ * install() adds the pool to a frame as window.vdom_processes together
+ * with a small library, window.vdom_proc, which wraps it in callbacks:
+ *
+ *   var id = vdom_proc.run(program, args, {
+ *       stdout: function (text) {},
+ *       stderr: function (text) {},
+ *       exit: function (exitCode, err) {}
+ *   });
+ *   vdom_proc.kill(id);
+ *
+ * err is null unless the program could not be run or crashed, in
+ * which case exitCode is -1. */
+class ProcessPool : public QObject {
+    Q_OBJECT
+public:
+    ProcessPool(QObject* parent = 0);
+    ~ProcessPool();
+
+    /* the limit of pools created from now on, 0 for one process per
+     * CPU core (the default) */
+    static void setDefaultLimit(int limit);
+
+    void setLimit(int limit);
+
+    int limit() const {
+        return m_limit;
+    }
+
+    /* expose the pool to the scripts of frame */
+    void install(QWebFrame* frame);
+
+public slots:
+    /* returns the id the signals of the call will carry */
+    int start(const QString& program, const QStringList& args);
+    /* kill a call that is running or drop one still waiting */
+    bool kill(int id);
+
+signals:
+    /* stream is "stdout" or "stderr" */
+    void output(int id, const QString& stream, const QString& text);
+    void finished(int id, int exitCode, const QString& error);
+
+private slots:
+    void startNext();
+    void readOutput();
+    void processError(QProcess::ProcessError error);
+    void processFinished(int exitCode, QProcess::ExitStatus status);
+
+private:
+    struct Call {
+        int id;
+        QString program;
+        QStringList args;
+    };
+
+    struct Running {
+        int id;
+        QTextDecoder* stdoutDecoder;
+        QTextDecoder* stderrDecoder;
+    };
+
+    void readOutput(QProcess* proc);
+    void done(QProcess* proc, int exitCode, const QString& error);
+
+    static int s_defaultLimit;
+
+    int m_limit;
+    int m_nextId;
+    QList<Call> m_waiting;
+    QHash<QProcess*, Running> m_running;
+};
+
+#endif // PROCESS_POOL_H
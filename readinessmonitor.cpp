@@ -0,0 +1,198 @@
+#include "readinessmonitor.h"
+#include "networkaccessmanager.h"
+
+#include <qwebframe.h>
+
+const static int POLL_INTERVAL = 100;
+
+/* Counts the DOM mutations of a frame for the Quiescent policy, once
+ * per frame. WebKit has no DOMAttrModified, so only nodes coming and
+ * going and text changing count; a class or style change does not. */
+const static char MUTATION_COUNTER[] =
+    "(function () {"
+      "if (window._vdom_mutations != null) return;"
+      "window._vdom_mutations = 0;"
+      "function mutated() { window._vdom_mutations++; }"
+      "var types = ['DOMNodeInserted', 'DOMNodeRemoved', 'DOMCharacterDataModified'];"
+      "for (var i = 0; i < types.length; i++)"
+        "document.addEventListener(types[i], mutated, true);"
+    "})();";
+
+/* Reports DOMContentLoaded of the main frame once a layout is done. */
+const static char READINESS_SCRIPT[] =
+    "(function () {"
+      "var monitor = window._vdom_readiness;"
+      "document.addEventListener('DOMContentLoaded', function () {"
+        "if (document.body) document.body.offsetHeight;"
+        "monitor.domContentLoaded();"
+      "}, false);"
+    "})();";
+
+int ReadinessMonitor::s_policy = ReadinessMonitor::LoadFinished;
+int ReadinessMonitor::s_idleTime = 500;
+int ReadinessMonitor::s_timeout = 0;
+
+void ReadinessMonitor::setDefaults(int policy, int idleTime, int timeout) {
+    s_policy = policy;
+    s_idleTime = idleTime;
+    s_timeout = timeout;
+}
+
+bool ReadinessMonitor::parsePolicy(const QString& name, int& policy) {
+    if (name == "load") {
+        policy = LoadFinished;
+    } else if (name == "dom") {
+        policy = DomReady;
+    } else if (name == "network-idle") {
+        policy = NetworkIdle;
+    } else if (name == "quiet") {
+        policy = Quiescent;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+ReadinessMonitor::ReadinessMonitor(QWebPage* page, NetworkAccessManager* network)
+    : QObject(page)
+    , m_page(page)
+    , m_network(network)
+    , m_policy(s_policy)
+    , m_idleTime(s_idleTime)
+    , m_timeout(s_timeout)
+    , m_fired(false)
+    , m_timedOut(false)
+    , m_domReady(false)
+    , m_condition("load")
+    , m_mutations(0)
+{
+    m_timeoutTimer.setSingleShot(true);
+    m_idleTimer.setSingleShot(true);
+    m_pollTimer.setInterval(POLL_INTERVAL);
+    connect(&m_timeoutTimer, SIGNAL(timeout()), this, SLOT(timedOut()));
+    connect(&m_idleTimer, SIGNAL(timeout()), this, SLOT(idleElapsed()));
+    connect(&m_pollTimer, SIGNAL(timeout()), this, SLOT(pollMutations()));
+
+    connect(m_page, SIGNAL(loadStarted()), this, SLOT(loadStarted()));
+    connect(m_page, SIGNAL(loadFinished(bool)), this, SLOT(loadFinished(bool)));
+    connect(m_page->mainFrame(), SIGNAL(javaScriptWindowObjectCleared()),
+            this, SLOT(installScript()));
+    connect(m_network, SIGNAL(runningRequestsChanged(int)),
+            this, SLOT(runningRequestsChanged(int)));
+}
+
+void ReadinessMonitor::loadStarted() {
+    m_fired = false;
+    m_timedOut = false;
+    m_domReady = false;
+    m_idleTimer.stop();
+    m_pollTimer.stop();
+    if (m_timeout > 0) {
+        m_timeoutTimer.start(m_timeout);
+    }
+}
+
+void ReadinessMonitor::loadFinished(bool ok) {
+    if (m_timedOut) {
+        /* what the Stop of timedOut() left behind */
+        return;
+    }
+    if (m_policy == LoadFinished) {
+        /* exactly the old behaviour, including loads that came
+         * without a loadStarted() */
+        m_fired = false;
+    }
+    if (!m_fired) {
+        fire(ok, ok ? "load" : "failed");
+    }
+}
+
+void ReadinessMonitor::installScript() {
+    if (m_policy == LoadFinished) {
+        return;
+    }
+    QWebFrame* frame = m_page->mainFrame();
+    frame->addToJavaScriptWindowObject("_vdom_readiness", this);
+    frame->evaluateJavaScript(QString::fromLatin1(MUTATION_COUNTER) +
+            QString::fromLatin1(READINESS_SCRIPT) + "true");
+}
+
+void ReadinessMonitor::domContentLoaded() {
+    if (m_fired || m_domReady) {
+        return;
+    }
+    m_domReady = true;
+    switch (m_policy) {
+    case DomReady:
+        fire(true, "dom-ready");
+        break;
+    case NetworkIdle:
+        runningRequestsChanged(m_network->runningRequests());
+        break;
+    case Quiescent:
+        m_mutations = -1;
+        pollMutations();
+        m_pollTimer.start();
+        break;
+    }
+}
+
+void ReadinessMonitor::runningRequestsChanged(int count) {
+    if (m_fired || !m_domReady || m_policy != NetworkIdle) {
+        return;
+    }
+    if (count == 0) {
+        m_idleTimer.start(m_idleTime);
+    } else {
+        m_idleTimer.stop();
+    }
+}
+
+/* the mutations of frame and its subframes; subframes get their
+ * counter here, the main frame before any of its scripts runs */
+static int countMutations(QWebFrame* frame) {
+    int mutations = frame->evaluateJavaScript(
+            QString::fromLatin1(MUTATION_COUNTER) + "window._vdom_mutations").toInt();
+    QList<QWebFrame*> children = frame->childFrames();
+    for (int i = 0; i < children.count(); i++) {
+        mutations += countMutations(children[i]);
+    }
+    return mutations;
+}
+
+void ReadinessMonitor::pollMutations() {
+    int mutations = countMutations(m_page->mainFrame());
+    if (mutations != m_mutations) {
+        m_mutations = mutations;
+        m_lastMutation.start();
+        return;
+    }
+    if (m_lastMutation.elapsed() >= m_idleTime) {
+        fire(true, "quiet");
+    }
+}
+
+void ReadinessMonitor::idleElapsed() {
+    fire(true, "network-idle");
+}
+
+void ReadinessMonitor::timedOut() {
+    if (m_fired) {
+        return;
+    }
+    /* stopping reports the load as failed, now or later */
+    m_timedOut = true;
+    m_page->triggerAction(QWebPage::Stop);
+    if (!m_fired) {
+        fire(true, "timeout");
+    }
+}
+
+void ReadinessMonitor::fire(bool ok, const char* condition) {
+    m_fired = true;
+    m_condition = condition;
+    m_timeoutTimer.stop();
+    m_idleTimer.stop();
+    m_pollTimer.stop();
+    emit ready(ok);
+}
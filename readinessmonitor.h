@@ -0,0 +1,107 @@
+#ifndef READINESS_MONITOR_H
+#define READINESS_MONITOR_H
+
+#include <qwebpage.h>
+#include <QtCore>
+
+class NetworkAccessManager;
+
+/* Decides when a page is ready to be dumped, instead of always
+ * waiting for loadFinished(), which also waits for every slow tracker
+ * pixel and never comes for some pages.
+ *
+ *   LoadFinished  loadFinished(), as before
+ *   DomReady      DOMContentLoaded, after forcing a layout
+ *   NetworkIdle   DOMContentLoaded and then no request running for
+ *                 idleTime() ms
+ *   Quiescent     DOMContentLoaded and then no DOM mutation, in any
+ *                 frame, for idleTime() ms; only nodes inserted or
+ *                 removed and text changed count, attribute, class
+ *                 and style changes go unseen
+ *
+ * The earlier of the policy's condition and loadFinished() wins. A
+ * hard timeout, counted from loadStarted(), stops the page and
+ * declares it ready as it is. ready() is emitted once per load, and
+ * condition() tells which of "load", "failed", "dom-ready",
+ * "network-idle", "quiet" or "timeout" fired.
+ *
+ * The DOM conditions rely on a script injected when the window object
+ * is created; with JavaScript disabled only loadFinished() and the
+ * timeout remain. */
+class ReadinessMonitor : public QObject {
+    Q_OBJECT
+public:
+    enum Policy {
+        LoadFinished = 0,
+        DomReady = 1,
+        NetworkIdle = 2,
+        Quiescent = 3
+    };
+
+    ReadinessMonitor(QWebPage* page, NetworkAccessManager* network);
+
+    /* for all monitors created from now on */
+    static void setDefaults(int policy, int idleTime, int timeout);
+    static bool parsePolicy(const QString& name, int& policy);
+
+    void setPolicy(int policy) {
+        m_policy = policy;
+    }
+
+    /* in ms */
+    void setIdleTime(int ms) {
+        m_idleTime = ms;
+    }
+
+    /* in ms, 0 for none */
+    void setTimeout(int ms) {
+        m_timeout = ms;
+    }
+
+    /* what fired the last ready(); a string literal */
+    const char* condition() const {
+        return m_condition;
+    }
+
+signals:
+    void ready(bool ok);
+
+public slots:
+    /* called by the injected script */
+    void domContentLoaded();
+
+private slots:
+    void loadStarted();
+    void loadFinished(bool ok);
+    void installScript();
+    void runningRequestsChanged(int count);
+    void pollMutations();
+    void timedOut();
+    void idleElapsed();
+
+private:
+    void fire(bool ok, const char* condition);
+
+    static int s_policy;
+    static int s_idleTime;
+    static int s_timeout;
+
+    QWebPage* m_page;
+    NetworkAccessManager* m_network;
+    int m_policy;
+    int m_idleTime;
+    int m_timeout;
+
+    bool m_fired;
+    bool m_timedOut;
+    bool m_domReady;
+    const char* m_condition;
+
+    QTimer m_timeoutTimer;
+    QTimer m_idleTimer;
+    QTimer m_pollTimer;
+    int m_mutations;
+    QTime m_lastMutation;
+};
+
+#endif // READINESS_MONITOR_H
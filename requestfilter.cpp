@@ -0,0 +1,167 @@
+#include "requestfilter.h"
+
+static const char* const TYPE_NAMES[] = {
+    "document", "stylesheet", "script", "image", "font", "media", "object"
+};
+
+RequestFilter* RequestFilter::instance() {
+    static RequestFilter* filter = 0;
+    if (!filter) {
+        filter = new RequestFilter;
+    }
+    return filter;
+}
+
+RequestFilter::RequestFilter()
+    : m_active(false), m_maxRequests(0), m_maxBytes(0)
+{
+    for (int i = 0; i < ResourceTypeCount; i++) {
+        m_blockType[i] = false;
+        m_blockThirdParty[i] = false;
+    }
+}
+
+bool RequestFilter::load(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        m_errorString = QString("Cannot read filter file %1: %2")
+            .arg(path).arg(file.errorString());
+        return false;
+    }
+
+    int lineNo = 0;
+    while (!file.atEnd()) {
+        QString line = QString::fromUtf8(file.readLine()).trimmed();
+        lineNo++;
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        QStringList words = line.split(QRegExp("\\s+"));
+        QString rule = words.takeFirst();
+        bool ok = true;
+        if ((rule == "block" || rule == "allow") && words.count() == 1) {
+            QRegExp re(words.first(), Qt::CaseInsensitive, QRegExp::Wildcard);
+            ok = re.isValid();
+            (rule == "block" ? m_block : m_allow).append(re);
+        } else if (rule == "block-type" && !words.isEmpty()) {
+            ok = parseTypes(words, m_blockType);
+        } else if (rule == "block-third-party") {
+            if (words.isEmpty()) {
+                for (int i = 0; i < ResourceTypeCount; i++)
+                    m_blockThirdParty[i] = i != Document;
+            } else {
+                ok = parseTypes(words, m_blockThirdParty);
+            }
+        } else if (rule == "max-requests" && words.count() == 1) {
+            m_maxRequests = words.first().toInt(&ok);
+        } else if (rule == "max-bytes" && words.count() == 1) {
+            QString n = words.first().toLower();
+            qint64 unit = 1;
+            if (n.endsWith('k')) {
+                unit = 1024;
+                n.chop(1);
+            } else if (n.endsWith('m')) {
+                unit = 1024 * 1024;
+                n.chop(1);
+            }
+            m_maxBytes = n.toLongLong(&ok) * unit;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            m_errorString = QString("%1:%2: invalid rule \"%3\"")
+                .arg(path).arg(lineNo).arg(line);
+            return false;
+        }
+    }
+    m_active = true;
+    return true;
+}
+
+bool RequestFilter::parseTypes(const QStringList& names, bool* types) {
+    for (int i = 0; i < names.count(); i++) {
+        int t = 0;
+        while (t < ResourceTypeCount && names[i] != TYPE_NAMES[t])
+            t++;
+        if (t == ResourceTypeCount)
+            return false;
+        types[t] = true;
+    }
+    return true;
+}
+
+bool RequestFilter::isAllowed(const QUrl& url) const {
+    if (m_allow.isEmpty()) {
+        return false;
+    }
+    QString str = url.toString();
+    for (int i = 0; i < m_allow.count(); i++) {
+        if (m_allow[i].exactMatch(str))
+            return true;
+    }
+    return false;
+}
+
+QString RequestFilter::check(const QNetworkRequest& request, const QUrl& pageUrl) const {
+    const QUrl& url = request.url();
+    if (isAllowed(url)) {
+        return QString();
+    }
+
+    QString str = url.toString();
+    for (int i = 0; i < m_block.count(); i++) {
+        if (m_block[i].exactMatch(str))
+            return QString("matches %1").arg(m_block[i].pattern());
+    }
+
+    ResourceType type = resourceType(request);
+    if (m_blockType[type]) {
+        return QString("%1 requests are blocked").arg(TYPE_NAMES[type]);
+    }
+    if (m_blockThirdParty[type] && !pageUrl.isEmpty() &&
+            site(url.host()) != site(pageUrl.host())) {
+        return QString("third-party %1").arg(TYPE_NAMES[type]);
+    }
+    return QString();
+}
+
+RequestFilter::ResourceType RequestFilter::resourceType(const QNetworkRequest& request) {
+    QString path = request.url().path().toLower();
+    int dot = path.lastIndexOf('.');
+    QString ext = dot < 0 || dot < path.lastIndexOf('/') ? QString() : path.mid(dot + 1);
+
+    if (ext == "css")
+        return Stylesheet;
+    if (ext == "js")
+        return Script;
+    if (ext == "png" || ext == "jpg" || ext == "jpeg" || ext == "gif" ||
+            ext == "bmp" || ext == "ico" || ext == "svg" || ext == "webp")
+        return Image;
+    if (ext == "woff" || ext == "woff2" || ext == "ttf" || ext == "otf" || ext == "eot")
+        return Font;
+    if (ext == "mp3" || ext == "mp4" || ext == "flv" || ext == "ogg" ||
+            ext == "webm" || ext == "wav" || ext == "avi")
+        return Media;
+    if (ext == "swf" || ext == "jar" || ext == "class")
+        return Object;
+
+    QByteArray accept = request.rawHeader("Accept");
+    if (accept.startsWith("text/css"))
+        return Stylesheet;
+    if (accept.startsWith("image/"))
+        return Image;
+    return Document;
+}
+
+QString RequestFilter::site(const QString& host) {
+    QStringList labels = host.toLower().split('.');
+    int keep = 2;
+    /* country domains with a generic second level, e.g. .com.cn */
+    if (labels.count() > 2 && labels.last().length() == 2) {
+        static const QStringList generic = QStringList()
+            << "com" << "net" << "org" << "gov" << "edu" << "co" << "ac";
+        if (generic.contains(labels[labels.count() - 2]))
+            keep = 3;
+    }
+    return QStringList(labels.mid(qMax(labels.count() - keep, 0))).join(".");
+}
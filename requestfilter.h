@@ -0,0 +1,85 @@
+#ifndef REQUEST_FILTER_H
+#define REQUEST_FILTER_H
+
+#include <QtNetwork>
+
+/* Decides which subresource requests of a page are worth making.
+ *
+ * Rules are read from a text file (--filter=FILE), one per line:
+ *
+ *   block <pattern>            block URLs matching the wildcard pattern
+ *   allow <pattern>            never block matching URLs (wins over
+ *                              every other rule and budget)
+ *   block-type <type>...       block resource types: document,
+ *                              stylesheet, script, image, font, media,
+ *                              object
+ *   block-third-party [<type>...]
+ *                              block requests to other sites than the
+ *                              page's own, either of the given types or
+ *                              of all types but document
+ *   max-requests <n>           at most n requests per page
+ *   max-bytes <n>[k|m]         at most n bytes downloaded per page
+ *
+ * Blank lines and lines starting with '#' are ignored. The document
+ * the user navigated to is never blocked. */
+class RequestFilter {
+public:
+    enum ResourceType {
+        Document,
+        Stylesheet,
+        Script,
+        Image,
+        Font,
+        Media,
+        Object,
+        ResourceTypeCount
+    };
+
+    static RequestFilter* instance();
+
+    bool load(const QString& path);
+
+    const QString& errorString() const {
+        return m_errorString;
+    }
+
+    bool isActive() const {
+        return m_active;
+    }
+
+    /* 0 for no limit */
+    int maxRequests() const {
+        return m_maxRequests;
+    }
+
+    qint64 maxBytes() const {
+        return m_maxBytes;
+    }
+
+    bool isAllowed(const QUrl& url) const;
+
+    /* The reason the request is to be blocked, or a null string. */
+    QString check(const QNetworkRequest& request, const QUrl& pageUrl) const;
+
+    /* guessed from the extension and the Accept header */
+    static ResourceType resourceType(const QNetworkRequest& request);
+
+    /* "www.news.yahoo.com.cn" -> "yahoo.com.cn" */
+    static QString site(const QString& host);
+
+private:
+    RequestFilter();
+
+    bool parseTypes(const QStringList& names, bool* types);
+
+    bool m_active;
+    QList<QRegExp> m_block;
+    QList<QRegExp> m_allow;
+    bool m_blockType[ResourceTypeCount];
+    bool m_blockThirdParty[ResourceTypeCount];
+    int m_maxRequests;
+    qint64 m_maxBytes;
+    QString m_errorString;
+};
+
+#endif // REQUEST_FILTER_H
@@ -0,0 +1,74 @@
+#include "scriptcache.h"
+#include "logger.h"
+
+ScriptCache* ScriptCache::instance() {
+    static ScriptCache* cache = 0;
+    if (!cache) {
+        cache = new ScriptCache;
+    }
+    return cache;
+}
+
+ScriptCache::ScriptCache() {
+    connect(&m_watcher, SIGNAL(fileChanged(const QString&)),
+            this, SLOT(fileChanged(const QString&)));
+    connect(&m_watcher, SIGNAL(directoryChanged(const QString&)),
+            this, SLOT(directoryChanged(const QString&)));
+}
+
+QString ScriptCache::script(const QString& fileName) {
+    QString path = QFileInfo(fileName).absoluteFilePath();
+    QHash<QString, QString>::const_iterator it = m_scripts.constFind(path);
+    if (it != m_scripts.constEnd()) {
+        return it.value();
+    }
+    QString js = load(path);
+    /* misses are cached too (as null strings) until the directory
+     * changes */
+    m_scripts.insert(path, js);
+    return js;
+}
+
+QString ScriptCache::load(const QString& path) {
+    /* watch the directory as well, so that files which are missing
+     * now or get replaced by rename() are noticed */
+    QString dir = QFileInfo(path).absolutePath();
+    if (!m_watcher.directories().contains(dir)) {
+        m_watcher.addPath(dir);
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        VDOM_LOG(General, Warning, QString("Failed to load js file %1: %2")
+                .arg(path).arg(file.errorString()));
+        return QString();
+    }
+    VDOM_LOG(General, Debug, "Loading JS file " + path);
+    QString js = QString::fromUtf8(file.readAll()) + "\n";
+    file.close();
+
+    if (!m_watcher.files().contains(path)) {
+        m_watcher.addPath(path);
+    }
+    return js;
+}
+
+void ScriptCache::fileChanged(const QString& path) {
+    m_scripts.remove(path);
+    /* some editors save by replacing the file, which removes it from
+     * the watcher; load() adds it back */
+    m_watcher.removePath(path);
+}
+
+void ScriptCache::directoryChanged(const QString& path) {
+    QMutableHashIterator<QString, QString> it(m_scripts);
+    while (it.hasNext()) {
+        it.next();
+        if (QFileInfo(it.key()).absolutePath() != path)
+            continue;
+        /* only misses and replaced files need a reload */
+        if (it.value().isNull() || !m_watcher.files().contains(it.key())) {
+            it.remove();
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef SCRIPT_CACHE_H
+#define SCRIPT_CACHE_H
+
+#include <QtCore>
+
+/* In-memory cache of the --js/--early-js files. Every script is read
+ * from disk once and handed out from memory afterwards; a
+ * QFileSystemWatcher drops an entry as soon as its file changes, so
+ * edits are picked up on the next page load. Shared by every window
+ * and batch job of the process. */
+class ScriptCache : public QObject {
+    Q_OBJECT
+public:
+    static ScriptCache* instance();
+
+    /* Returns the contents of the script, or a null QString if it
+     * does not exist or cannot be read. */
+    QString script(const QString& fileName);
+
+private slots:
+    void fileChanged(const QString& path);
+    void directoryChanged(const QString& path);
+
+private:
+    ScriptCache();
+
+    QString load(const QString& fileName);
+
+    QFileSystemWatcher m_watcher;
+    QHash<QString, QString> m_scripts;
+};
+
+#endif // SCRIPT_CACHE_H
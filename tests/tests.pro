@@ -0,0 +1,15 @@
+# Round trips of the dump formats hunters get to read:
+#
+#   qmake && make && ./tst_dumpformats
+TEMPLATE = app
+TARGET = tst_dumpformats
+SOURCES += tst_dumpformats.cpp \
+           ../vdombinary.cpp \
+           ../dumpdelta.cpp
+HEADERS += ../vdombinary.h \
+           ../dumpdelta.h
+
+CONFIG -= app_bundle
+CONFIG += qt warn_on qtestlib
+QT -= gui
+INCLUDEPATH += ..
@@ -0,0 +1,126 @@
+#include <QtTest>
+
+#include "vdombinary.h"
+#include "dumpdelta.h"
+
+/* Every dump must come back byte for byte out of VdomBinary::decode()
+ * and DumpDelta::apply(), as it must out of hunter/VdomDump.pm. */
+class TestDumpFormats : public QObject {
+    Q_OBJECT
+private slots:
+    void binaryRoundTrip_data();
+    void binaryRoundTrip();
+    void corruptBinary_data();
+    void corruptBinary();
+    void deltaRoundTrip_data();
+    void deltaRoundTrip();
+    void deltaAgainstOtherBase();
+};
+
+/* about 1.5 MB, so the compressed stream takes several chunks */
+static QByteArray bigDump() {
+    QByteArray text;
+    for (int i = 0; i < 40000; i++) {
+        text += "div class=\"c" + QByteArray::number(i % 7) + "\" 10 " +
+            QByteArray::number(i) + " -" + QByteArray::number(i * 3) +
+            " 0 w=" + QByteArray::number(i * 7919 % 1000003) + "\n";
+    }
+    return text;
+}
+
+void TestDumpFormats::binaryRoundTrip_data() {
+    QTest::addColumn<QByteArray>("text");
+    QTest::newRow("empty") << QByteArray("");
+    QTest::newRow("one line") << QByteArray("html 0 0 1024 768");
+    QTest::newRow("empty lines") << QByteArray("\n\nx\n\n");
+    QTest::newRow("not integers") << QByteArray("-0 007 2147483648 -2147483649 1-2 --3 -");
+    QTest::newRow("int32 limits") << QByteArray("2147483647 -2147483648 0");
+    QTest::newRow("long runs") << QByteArray(300, 'x') + "\n" + QByteArray(300, 'x');
+    QTest::newRow("binary bytes") << QByteArray("a\0b\r\n\xff", 6);
+    QTest::newRow("big") << bigDump();
+}
+
+void TestDumpFormats::binaryRoundTrip() {
+    QFETCH(QByteArray, text);
+    int formats[] = { VdomBinary::BinaryDump, VdomBinary::CompressedBinaryDump };
+    for (int i = 0; i < 2; i++) {
+        QByteArray data = VdomBinary::encode(text, formats[i]);
+        QVERIFY(VdomBinary::isBinary(data));
+        QByteArray decoded;
+        QString error;
+        QVERIFY2(VdomBinary::decode(data, decoded, error), qPrintable(error));
+        QCOMPARE(decoded, text);
+    }
+    QCOMPARE(VdomBinary::encode(text, VdomBinary::TextDump), text);
+}
+
+void TestDumpFormats::corruptBinary_data() {
+    QTest::addColumn<QByteArray>("data");
+    QByteArray header("VDB1\0\0\0\0", 8);
+    QByteArray compressedHeader("VDB1\1\0\0\0", 8);
+    /* a string length of 2^31 */
+    QTest::newRow("huge length") << header + QByteArray("\x01\x80\x80\x80\x80\x08" "abc", 9);
+    QTest::newRow("truncated string") << header + QByteArray("\x01\x05" "abc", 5);
+    QTest::newRow("undefined string") << header + QByteArray("\x02\x00", 2);
+    QTest::newRow("truncated integer") << header + QByteArray("\x03\x01\x02", 3);
+    QTest::newRow("unknown opcode") << header + QByteArray("\x07", 1);
+    QTest::newRow("bad chunk") << compressedHeader + QByteArray("\0\0\0\3xyz", 7);
+    QTest::newRow("short chunk") << compressedHeader + QByteArray("\0\0\1\0xyz", 7);
+}
+
+void TestDumpFormats::corruptBinary() {
+    QFETCH(QByteArray, data);
+    QByteArray text;
+    QString error;
+    QVERIFY(!VdomBinary::decode(data, text, error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TestDumpFormats::deltaRoundTrip_data() {
+    QTest::addColumn<QByteArray>("base");
+    QTest::addColumn<QByteArray>("text");
+    QByteArray lines;
+    for (int i = 0; i < 20; i++) {
+        lines += "line " + QByteArray::number(i) + "\n";
+    }
+    QByteArray changed = lines;
+    changed.replace("line 7\n", "line seven\nline 7.5\n");
+    QByteArray removed = lines;
+    removed.replace("line 12\nline 13\n", "");
+    QTest::newRow("same") << lines << lines;
+    QTest::newRow("changed") << lines << changed;
+    QTest::newRow("removed") << lines << removed;
+    QTest::newRow("appended") << lines << lines + "line 20\n";
+    QTest::newRow("appended to last line") << lines + "tail" << lines + "tail\nmore";
+    QTest::newRow("last line dropped") << lines + "tail" << lines.left(lines.size() - 1);
+    QTest::newRow("prepended") << lines << "line -1\n" + lines;
+    QByteArray big = bigDump();
+    QByteArray bigChanged = big;
+    bigChanged.replace("w=7919\n", "w=0\n");
+    QTest::newRow("big") << big << bigChanged;
+}
+
+void TestDumpFormats::deltaRoundTrip() {
+    QFETCH(QByteArray, base);
+    QFETCH(QByteArray, text);
+    QByteArray delta = DumpDelta::make(base, text);
+    QVERIFY(!delta.isNull());
+    QVERIFY(DumpDelta::isDelta(delta));
+    QByteArray applied;
+    QString error;
+    QVERIFY2(DumpDelta::apply(base, delta, applied, error), qPrintable(error));
+    QCOMPARE(applied, text);
+}
+
+void TestDumpFormats::deltaAgainstOtherBase() {
+    QByteArray base("a\nb\nc\nd\ne\nf\n");
+    QByteArray delta = DumpDelta::make(base, "a\nb\nX\nd\ne\nf\n");
+    QByteArray text;
+    QString error;
+    QVERIFY(!DumpDelta::apply("a\nb\nc\n", delta, text, error));
+    QVERIFY(!error.isEmpty());
+}
+
+QTEST_APPLESS_MAIN(TestDumpFormats)
+
+#include "tst_dumpformats.moc"
@@ -0,0 +1,155 @@
+#include "tracer.h"
+#include "jsonwriter.h"
+#include "logger.h"
+
+#include <time.h>
+#include <unistd.h>
+
+bool Tracer::s_enabled = false;
+
+Tracer* Tracer::instance() {
+    static Tracer* tracer = 0;
+    if (!tracer) {
+        tracer = new Tracer;
+    }
+    return tracer;
+}
+
+Tracer::Tracer() : m_first(true), m_nextPage(1) {
+}
+
+qint64 Tracer::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool Tracer::open(const QString& path) {
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_errorString = QString("Cannot write trace file %1: %2")
+            .arg(path).arg(m_file.errorString());
+        return false;
+    }
+    /* the viewers accept a missing closing bracket, so a crashed run
+     * still leaves a usable trace */
+    m_file.write("[\n");
+    m_first = true;
+    s_enabled = true;
+    return true;
+}
+
+void Tracer::close() {
+    if (!m_file.isOpen()) {
+        return;
+    }
+    QList<int> pages = m_pages.keys();
+    for (int i = 0; i < pages.count(); i++) {
+        endPage(pages[i], "unfinished");
+    }
+    m_file.write("\n]\n");
+    m_file.close();
+    s_enabled = false;
+}
+
+int Tracer::beginPage(const QString& url) {
+    if (!s_enabled) {
+        return -1;
+    }
+    int id = m_nextPage++;
+    Page& page = m_pages[id];
+    page.url = url;
+    page.start = now();
+    return id;
+}
+
+void Tracer::setPageUrl(int id, const QString& url) {
+    if (!s_enabled || id < 0) {
+        return;
+    }
+    QHash<int, Page>::iterator it = m_pages.find(id);
+    if (it != m_pages.end()) {
+        it.value().url = url;
+    }
+}
+
+void Tracer::span(int id, const char* name, qint64 start, qint64 end) {
+    if (!s_enabled || id < 0) {
+        return;
+    }
+    QHash<int, Page>::iterator it = m_pages.find(id);
+    if (it == m_pages.end()) {
+        return;
+    }
+
+    writeEvent(QByteArray("{\"name\":\"") + name + "\",\"cat\":\"page\",\"ph\":\"X\""
+            ",\"ts\":" + QByteArray::number(start) +
+            ",\"dur\":" + QByteArray::number(end - start) +
+            ",\"pid\":" + QByteArray::number(getpid()) +
+            ",\"tid\":" + QByteArray::number(id) + "}");
+
+    QList<QPair<const char*, qint64> >& phases = it.value().phases;
+    for (int i = 0; i < phases.count(); i++) {
+        if (qstrcmp(phases[i].first, name) == 0) {
+            phases[i].second += end - start;
+            return;
+        }
+    }
+    phases.append(qMakePair(name, end - start));
+}
+
+void Tracer::instant(int id, const char* name) {
+    if (!s_enabled || id < 0) {
+        return;
+    }
+    QHash<int, Page>::iterator it = m_pages.find(id);
+    if (it == m_pages.end()) {
+        return;
+    }
+    writeEvent(QByteArray("{\"name\":\"") + name + "\",\"cat\":\"page\",\"ph\":\"i\""
+            ",\"s\":\"t\",\"ts\":" + QByteArray::number(now()) +
+            ",\"pid\":" + QByteArray::number(getpid()) +
+            ",\"tid\":" + QByteArray::number(id) + "}");
+    it.value().instants.append(name);
+}
+
+void Tracer::endPage(int id, const char* outcome) {
+    if (!s_enabled || id < 0) {
+        return;
+    }
+    QHash<int, Page>::iterator it = m_pages.find(id);
+    if (it == m_pages.end()) {
+        return;
+    }
+    const Page& page = it.value();
+
+    /* name the page's track after its URL */
+    writeEvent("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" +
+            QByteArray::number(getpid()) + ",\"tid\":" + QByteArray::number(id) +
+            ",\"args\":{\"name\":" + JsonWriter::quote(page.url) + "}}");
+
+    QString line = QString("trace: page %1 %2 %3 %4 ms:")
+        .arg(id).arg(page.url).arg(outcome)
+        .arg((now() - page.start) / 1000.0, 0, 'f', 1);
+    for (int i = 0; i < page.instants.count(); i++) {
+        line += QString(" [%1]").arg(page.instants[i]);
+    }
+    for (int i = 0; i < page.phases.count(); i++) {
+        line += QString(" %1 %2")
+            .arg(page.phases[i].first)
+            .arg(page.phases[i].second / 1000.0, 0, 'f', 1);
+    }
+    VDOM_LOG(General, Info, line);
+
+    m_pages.erase(it);
+    m_file.flush();
+}
+
+void Tracer::writeEvent(const QByteArray& event) {
+    if (!m_first) {
+        m_file.write(",\n");
+    }
+    m_first = false;
+    m_file.write(event);
+}
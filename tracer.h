@@ -0,0 +1,90 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QtCore>
+
+/* Per-page phase timeline (load, inject, dump, write, hunt, parse,
+ * annotate, ...) written as a Chrome trace-event JSON file, which
+ * chrome://tracing and Perfetto open directly. Every page gets its
+ * own track, named after its URL. When a page is done a one-line
+ * summary of its phases is logged as well (General, Info).
+ *
+ * Tracing is off unless open() was called (--trace=FILE); then every
+ * hook costs a single test of a static flag. Not thread-safe: call it
+ * from the GUI thread only. */
+class Tracer {
+public:
+    static Tracer* instance();
+
+    static bool isEnabled() {
+        return s_enabled;
+    }
+
+    /* monotonic clock in microseconds */
+    static qint64 now();
+
+    bool open(const QString& path);
+    void close();
+
+    const QString& errorString() const {
+        return m_errorString;
+    }
+
+    /* Start the timeline of a page and return its id, -1 when
+     * tracing is off. The URL may be set later, once known. */
+    int beginPage(const QString& url = QString());
+    void setPageUrl(int page, const QString& url);
+
+    /* Record that the page spent [start, end) in the named phase. The
+     * name must be a string literal. */
+    void span(int page, const char* name, qint64 start, qint64 end);
+
+    /* Record that something happened to the page just now, e.g. which
+     * readiness condition fired. The name must be a string literal. */
+    void instant(int page, const char* name);
+
+    /* Print the summary of the page and forget it. */
+    void endPage(int page, const char* outcome = "done");
+
+private:
+    Tracer();
+
+    struct Page {
+        QString url;
+        qint64 start;
+        /* total time per phase, in order of appearance */
+        QList<QPair<const char*, qint64> > phases;
+        QList<const char*> instants;
+    };
+
+    void writeEvent(const QByteArray& event);
+
+    static bool s_enabled;
+
+    QFile m_file;
+    bool m_first;
+    int m_nextPage;
+    QHash<int, Page> m_pages;
+    QString m_errorString;
+};
+
+/* Records the enclosing block as a phase of the page. */
+class TraceScope {
+public:
+    TraceScope(int page, const char* name)
+        : m_page(page), m_name(name),
+          m_start(Tracer::isEnabled() ? Tracer::now() : 0) {}
+
+    ~TraceScope() {
+        if (Tracer::isEnabled()) {
+            Tracer::instance()->span(m_page, m_name, m_start, Tracer::now());
+        }
+    }
+
+private:
+    int m_page;
+    const char* m_name;
+    qint64 m_start;
+};
+
+#endif // TRACER_H
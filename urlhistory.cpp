@@ -0,0 +1,62 @@
+#include "urlhistory.h"
+#include "logger.h"
+
+const static char HISTORY_FILE[] = "url-history.txt";
+
+UrlHistory* UrlHistory::instance() {
+    static UrlHistory* history = 0;
+    if (!history) {
+        history = new UrlHistory;
+    }
+    return history;
+}
+
+UrlHistory::UrlHistory() {
+    QString dir = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+    if (dir.isEmpty() || !QDir().mkpath(dir)) {
+        VDOM_LOG(General, Warning, "No location to store the URL history in.");
+        return;
+    }
+    m_file.setFileName(QDir(dir).filePath(HISTORY_FILE));
+    load();
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        VDOM_LOG(General, Warning, QString("Failed to open URL history %1: %2")
+                .arg(m_file.fileName()).arg(m_file.errorString()));
+    }
+}
+
+void UrlHistory::load() {
+    QFile file(m_file.fileName());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return;
+    }
+    while (!file.atEnd()) {
+        QString url = QString::fromUtf8(file.readLine()).trimmed();
+        if (url.isEmpty() || m_seen.contains(url))
+            continue;
+        m_seen.insert(url);
+        m_sorted.append(url);
+    }
+    file.close();
+
+    /* sort once and hand the model the whole list in one go */
+    qSort(m_sorted);
+    m_model.setStringList(m_sorted);
+}
+
+void UrlHistory::add(const QString& url) {
+    if (url.isEmpty() || m_seen.contains(url))
+        return;
+    m_seen.insert(url);
+
+    int row = qLowerBound(m_sorted.begin(), m_sorted.end(), url) - m_sorted.begin();
+    m_sorted.insert(row, url);
+    m_model.insertRows(row, 1);
+    m_model.setData(m_model.index(row), url);
+
+    if (m_file.isOpen()) {
+        m_file.write(url.toUtf8());
+        m_file.write("\n", 1);
+        m_file.flush();
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef URL_HISTORY_H
+#define URL_HISTORY_H
+
+#include <QtGui>
+
+/* The history of visited locations behind the location bar completer.
+ *
+ * Entries are deduplicated through a hash and kept in a model sorted
+ * case-sensitively, so that a QCompleter using
+ * CaseSensitivelySortedModel finds prefix matches by binary search
+ * instead of scanning every entry. New entries are inserted as single
+ * rows. The history is shared by all windows of the process and is
+ * persisted in an append-only file, one entry per line. */
+class UrlHistory : public QObject {
+    Q_OBJECT
+public:
+    static UrlHistory* instance();
+
+    QAbstractItemModel* model() {
+        return &m_model;
+    }
+
+    int count() const {
+        return m_sorted.count();
+    }
+
+    bool contains(const QString& url) const {
+        return m_seen.contains(url);
+    }
+
+public slots:
+    /* Add a location; known ones are ignored. */
+    void add(const QString& url);
+
+private:
+    UrlHistory();
+
+    void load();
+
+    QStringListModel m_model;
+    /* mirrors the model, for lower bound lookups */
+    QStringList m_sorted;
+    QSet<QString> m_seen;
+    QFile m_file;
+};
+
+#endif // URL_HISTORY_H
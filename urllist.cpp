@@ -0,0 +1,169 @@
+#include "urllist.h"
+
+#include <QtConcurrentRun>
+#include <cctype>
+#include <cstring>
+
+/* lines indexed synchronously by open() */
+const static int FIRST_CHUNK = 1000;
+
+/* lines sharing one 64-bit base offset; a block of BLOCK_SIZE lines
+ * must span less than 4 GB */
+const static int BLOCK_SIZE = 1024;
+
+/* lines indexed by the worker between two countChanged() signals */
+const static int INDEX_BATCH = 64 * 1024;
+
+UrlList::UrlList(QObject* parent)
+    : QObject(parent)
+    , m_data(0)
+    , m_size(0)
+    , m_complete(true)
+    , m_abort(false)
+{
+}
+
+UrlList::~UrlList() {
+    close();
+}
+
+bool UrlList::open(const QString& fileName) {
+    close();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    m_size = m_file.size();
+    if (m_size > 0) {
+        m_data = (const char*) m_file.map(0, m_size);
+        if (!m_data) {
+            m_errorString = m_file.errorString();
+            m_file.close();
+            m_size = 0;
+            return false;
+        }
+    }
+
+    m_complete = false;
+    qint64 pos = indexLines(0, FIRST_CHUNK);
+    if (pos >= m_size) {
+        QMutexLocker locker(&m_mutex);
+        m_complete = true;
+    } else {
+        m_indexer = QtConcurrent::run(this, &UrlList::indexRest, pos);
+    }
+    return true;
+}
+
+void UrlList::close() {
+    m_abort = true;
+    m_indexer.waitForFinished();
+    m_abort = false;
+
+    QMutexLocker locker(&m_mutex);
+    if (m_data) {
+        m_file.unmap((uchar*) m_data);
+        m_data = 0;
+    }
+    m_file.close();
+    m_size = 0;
+    m_blockBase.clear();
+    m_offsets.clear();
+    m_complete = true;
+    m_grown.wakeAll();
+}
+
+int UrlList::count() const {
+    QMutexLocker locker(&m_mutex);
+    return m_offsets.size();
+}
+
+bool UrlList::isComplete() const {
+    QMutexLocker locker(&m_mutex);
+    return m_complete;
+}
+
+QString UrlList::at(int i) const {
+    QMutexLocker locker(&m_mutex);
+    if (i < 0 || i >= m_offsets.size()) {
+        return QString();
+    }
+    qint64 start = m_blockBase.at(i / BLOCK_SIZE) + m_offsets.at(i);
+    locker.unlock();
+
+    const char* nl = (const char*) memchr(m_data + start, '\n', m_size - start);
+    qint64 end = nl ? nl - m_data : m_size;
+    while (end > start && isspace((uchar) m_data[end - 1])) {
+        end--;
+    }
+    return QString::fromUtf8(m_data + start, end - start);
+}
+
+bool UrlList::waitForCount(int n) const {
+    QMutexLocker locker(&m_mutex);
+    while (m_offsets.size() < n && !m_complete) {
+        m_grown.wait(&m_mutex);
+    }
+    return m_offsets.size() >= n;
+}
+
+/* Index up to maxLines non-blank lines starting at byte offset from
+ * and return the offset where scanning stopped. */
+qint64 UrlList::indexLines(qint64 from, int maxLines) {
+    QVector<qint64> found;
+    qint64 pos = from;
+    while (pos < m_size && found.size() < maxLines) {
+        const char* nl = (const char*) memchr(m_data + pos, '\n', m_size - pos);
+        qint64 end = nl ? nl - m_data : m_size;
+        qint64 start = pos;
+        while (start < end && isspace((uchar) m_data[start])) {
+            start++;
+        }
+        if (start < end) {
+            found.append(start);
+        }
+        pos = end + 1;
+    }
+    appendOffsets(found);
+    return pos;
+}
+
+void UrlList::indexRest(qint64 from) {
+    qint64 pos = from;
+    while (pos < m_size && !m_abort) {
+        pos = indexLines(pos, INDEX_BATCH);
+    }
+
+    int total;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_complete = true;
+        total = m_offsets.size();
+        m_grown.wakeAll();
+    }
+    if (!m_abort) {
+        emit completed(total);
+    }
+}
+
+void UrlList::appendOffsets(const QVector<qint64>& offsets) {
+    if (offsets.isEmpty())
+        return;
+
+    int total;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (int i = 0; i < offsets.size(); i++) {
+            qint64 offset = offsets.at(i);
+            if (m_offsets.size() % BLOCK_SIZE == 0) {
+                m_blockBase.append(offset);
+            }
+            m_offsets.append((quint32) (offset - m_blockBase.last()));
+        }
+        total = m_offsets.size();
+        m_grown.wakeAll();
+    }
+    emit countChanged(total);
+}
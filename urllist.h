@@ -0,0 +1,69 @@
+#ifndef URLLIST_H
+#define URLLIST_H
+
+#include <QtCore>
+#include <QFuture>
+
+/* A read-only, memory-mapped list of URLs, one per line.
+ *
+ * Blank lines are skipped and lines may be of any length. Instead of
+ * copying the lines into QStrings up front we only build an index of
+ * line offsets: the first FIRST_CHUNK lines synchronously in open(),
+ * so the first page can be shown right away, and the rest on a worker
+ * thread. at() is O(1) and only decodes the line asked for.
+ *
+ * The index takes 4 bytes per line plus 8 bytes per block of
+ * BLOCK_SIZE lines. */
+class UrlList : public QObject
+{
+    Q_OBJECT
+public:
+    UrlList(QObject* parent = 0);
+    ~UrlList();
+
+    bool open(const QString& fileName);
+    void close();
+
+    const QString& errorString() const {
+        return m_errorString;
+    }
+
+    /* number of lines indexed so far */
+    int count() const;
+
+    /* true once the whole file has been indexed */
+    bool isComplete() const;
+
+    /* the i-th non-blank line, trimmed; i must be < count() */
+    QString at(int i) const;
+
+    /* Block until at least n lines are indexed or the whole file is.
+     * Returns whether n lines are available. */
+    bool waitForCount(int n) const;
+
+signals:
+    /* emitted from the indexing thread as the index grows */
+    void countChanged(int count);
+    void completed(int count);
+
+private:
+    qint64 indexLines(qint64 from, int maxLines);
+    void indexRest(qint64 from);
+    void appendOffsets(const QVector<qint64>& offsets);
+
+    QFile m_file;
+    const char* m_data;
+    qint64 m_size;
+    QString m_errorString;
+
+    mutable QMutex m_mutex;
+    mutable QWaitCondition m_grown;
+    QVector<qint64> m_blockBase;
+    QVector<quint32> m_offsets;
+    bool m_complete;
+
+    QFuture<void> m_indexer;
+    volatile bool m_abort;
+};
+
+#endif // URLLIST_H
@@ -1,35 +1,16 @@
 #include "urlloader.h"
+#include "logger.h"
 
-void URLLoader::loadNext() {
+bool URLLoader::nextUrl(QUrl& url, int& index) {
     QString qstr;
-    if (getUrl(qstr)) {
-        QUrl url;
+    while (getUrl(qstr)) {
+        url = QUrl();
         url.setEncodedUrl(qstr.toUtf8(), QUrl::StrictMode);
         if (url.isValid()) {
-            m_stdOut << "Loading " << qstr << " ......" << endl;
-            m_view->load(url);
-        } else
-            loadNext();
-    } else
-        disconnect(m_view, 0, this, 0);
-}
-
-void URLLoader::init(const QString& inputFileName) {
-    QFile inputFile(inputFileName);
-    if (inputFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QTextStream stream(&inputFile);
-        QString line;
-        while (true) {
-            line = stream.readLine();
-            if (line.isNull())
-                break;
-            m_urls.append(line);
+            index = m_index - 1;
+            return true;
         }
-    } else {
-        qDebug() << "Cant't open list file";
-        exit(0);
+        VDOM_LOG(Batch, Warning, "Skipping invalid URL " + qstr);
     }
-    m_index = 0;
-    inputFile.close();
+    return false;
 }
-
@@ -1,44 +1,56 @@
 #ifndef URLLOADER_H
 #define URLLOADER_H
 
-#include "qwebview.h"
-#include <QFile>
-#include <QVector>
-#include <QTextStream>
 #include <QtCore>
 
-class URLLoader : public QObject
+#include "urllist.h"
+#include "workqueue.h"
+
+/* A shared queue of URLs read from a list file. Every consumer
+ * (e.g. the jobs of a BatchCrawler) pulls the next URL from the
+ * same loader, so each URL is handed out exactly once. */
+class URLLoader : public QObject, public WorkQueue
 {
     Q_OBJECT
 public:
-    URLLoader(QWebView* view, const QString& inputFileName)
-        : m_view(view)
-        , m_stdOut(stdout)
+    URLLoader(const QString& inputFileName)
+        : m_index(0)
     {
-        init(inputFileName);
+        m_valid = m_urls.open(inputFileName);
     }
 
-public slots:
-    void loadNext();
+    virtual bool isValid() const {
+        return m_valid;
+    }
 
-private:
-    void init(const QString& inputFileName);
+    virtual QString errorString() const {
+        return m_urls.errorString();
+    }
 
+    /* lines indexed so far; the list is indexed in the background */
+    int count() const {
+        return m_urls.count();
+    }
+
+    /* Fetch the next valid URL and its index in the list file.
+     * Returns false when the list is exhausted. */
+    virtual bool nextUrl(QUrl& url, int& index);
+
+private:
     bool getUrl(QString& qstr)
     {
-        if (m_index == m_urls.size())
+        /* only blocks if we are ahead of the background indexer */
+        if (!m_urls.waitForCount(m_index + 1))
             return false;
 
-        qstr = m_urls[m_index++];
+        qstr = m_urls.at(m_index++);
         return true;
     }
 
 private:
-    QVector<QString> m_urls;
+    UrlList m_urls;
     int m_index;
-    QWebView* m_view;
-    QTextStream m_stdOut;
+    bool m_valid;
 };
 
 #endif
-
@@ -0,0 +1,327 @@
+#include "vdombinary.h"
+
+#include <climits>
+
+const static char MAGIC[] = "VDB1";
+const static int HEADER_SIZE = 8;
+const static char FLAG_COMPRESSED = 0x01;
+
+enum {
+    OP_NEW = 0x01,
+    OP_STR = 0x02,
+    OP_INT = 0x03,
+    OP_EOL = 0x04,
+    OP_LIT = 0x05
+};
+
+/* longer runs are mostly text content and rarely repeat */
+const static int MAX_INTERNED_LENGTH = 256;
+const static int MAX_TABLE_SIZE = 1 << 20;
+/* raw bytes per compressed chunk */
+const static int CHUNK_SIZE = 1 << 20;
+
+static void putVarint(QByteArray& out, quint32 v) {
+    while (v >= 0x80) {
+        out += char((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    out += char(v);
+}
+
+static void putInt32(QByteArray& out, qint32 v) {
+    quint32 u = quint32(v);
+    out += char(u & 0xff);
+    out += char((u >> 8) & 0xff);
+    out += char((u >> 16) & 0xff);
+    out += char((u >> 24) & 0xff);
+}
+
+static void putUInt32BE(QByteArray& out, quint32 v) {
+    out += char((v >> 24) & 0xff);
+    out += char((v >> 16) & 0xff);
+    out += char((v >> 8) & 0xff);
+    out += char(v & 0xff);
+}
+
+/* The length of the canonical int32 at p (no leading zeros, no "-0"),
+ * or 0 if there is none. */
+static int integerAt(const char* p, const char* end, qint32& value) {
+    const char* q = p;
+    bool negative = false;
+    if (*q == '-') {
+        negative = true;
+        q++;
+    }
+    if (q == end || *q < '0' || *q > '9') {
+        return 0;
+    }
+    if (*q == '0') {
+        if (negative || (q + 1 < end && q[1] >= '0' && q[1] <= '9'))
+            return 0;
+        value = 0;
+        return q + 1 - p;
+    }
+    qint64 v = 0;
+    const char* digits = q;
+    while (q < end && *q >= '0' && *q <= '9') {
+        if (q - digits >= 10)
+            return 0;
+        v = v * 10 + (*q - '0');
+        q++;
+    }
+    if (negative)
+        v = -v;
+    if (v < -2147483647LL - 1 || v > 2147483647LL)
+        return 0;
+    value = qint32(v);
+    return q - p;
+}
+
+namespace {
+
+class Encoder {
+public:
+    Encoder(bool compress) : m_compress(compress) {
+        m_out.append(MAGIC, 4);
+        m_out += compress ? FLAG_COMPRESSED : char(0);
+        m_out.append("\0\0\0", 3);
+    }
+
+    void text(const char* p, int len) {
+        if (len == 0)
+            return;
+        QByteArray str = QByteArray::fromRawData(p, len);
+        if (len > MAX_INTERNED_LENGTH) {
+            m_records += char(OP_LIT);
+            putVarint(m_records, len);
+            m_records.append(p, len);
+        } else {
+            QHash<QByteArray, int>::const_iterator it = m_table.constFind(str);
+            if (it != m_table.constEnd()) {
+                m_records += char(OP_STR);
+                putVarint(m_records, it.value());
+            } else {
+                m_records += char(m_table.count() < MAX_TABLE_SIZE ? OP_NEW : OP_LIT);
+                putVarint(m_records, len);
+                m_records.append(p, len);
+                if (m_table.count() < MAX_TABLE_SIZE) {
+                    /* deep copy: the key must outlive the dump */
+                    m_table.insert(QByteArray(p, len), m_table.count());
+                }
+            }
+        }
+        flushChunk(false);
+    }
+
+    void integer(qint32 v) {
+        m_records += char(OP_INT);
+        putInt32(m_records, v);
+    }
+
+    void endOfLine() {
+        m_records += char(OP_EOL);
+        flushChunk(false);
+    }
+
+    QByteArray finish() {
+        flushChunk(true);
+        return m_out;
+    }
+
+private:
+    void flushChunk(bool last) {
+        if (!m_compress) {
+            if (last || m_records.size() >= CHUNK_SIZE) {
+                m_out += m_records;
+                m_records.clear();
+            }
+            return;
+        }
+        if (m_records.isEmpty() || (!last && m_records.size() < CHUNK_SIZE))
+            return;
+        QByteArray chunk = qCompress(m_records);
+        putUInt32BE(m_out, chunk.size());
+        m_out += chunk;
+        m_records.clear();
+    }
+
+    bool m_compress;
+    QByteArray m_out;
+    QByteArray m_records;
+    QHash<QByteArray, int> m_table;
+};
+
+}
+
+QByteArray VdomBinary::encode(const QByteArray& text, int format) {
+    if (format != BinaryDump && format != CompressedBinaryDump) {
+        return text;
+    }
+    Encoder encoder(format == CompressedBinaryDump);
+
+    const char* p = text.constData();
+    const char* end = p + text.size();
+    const char* run = p;
+    while (p < end) {
+        if (*p == '\n') {
+            encoder.text(run, p - run);
+            encoder.endOfLine();
+            run = ++p;
+            continue;
+        }
+        qint32 value;
+        int len = (*p == '-' || (*p >= '0' && *p <= '9'))
+            ? integerAt(p, end, value) : 0;
+        if (len > 0) {
+            encoder.text(run, p - run);
+            encoder.integer(value);
+            p += len;
+            run = p;
+            continue;
+        }
+        p++;
+    }
+    encoder.text(run, p - run);
+    return encoder.finish();
+}
+
+bool VdomBinary::isBinary(const QByteArray& data) {
+    return data.size() >= HEADER_SIZE && data.startsWith(MAGIC);
+}
+
+bool VdomBinary::decode(const QByteArray& data, QByteArray& text, QString& errorString) {
+    VdomBinaryReader reader(data);
+    text.clear();
+    for (;;) {
+        switch (reader.next()) {
+        case VdomBinaryReader::String:
+            text += reader.string();
+            break;
+        case VdomBinaryReader::Integer:
+            text += QByteArray::number(reader.integer());
+            break;
+        case VdomBinaryReader::EndOfLine:
+            text += '\n';
+            break;
+        case VdomBinaryReader::End:
+            return true;
+        case VdomBinaryReader::Error:
+            errorString = reader.errorString();
+            return false;
+        }
+    }
+}
+
+VdomBinaryReader::VdomBinaryReader(const QByteArray& data)
+    : m_data(data), m_pos(HEADER_SIZE), m_compressed(false),
+      m_bufferPos(0), m_integer(0)
+{
+    if (!VdomBinary::isBinary(m_data)) {
+        m_errorString = "Not a VDB dump";
+        m_pos = m_data.size();
+        return;
+    }
+    m_compressed = m_data[4] & FLAG_COMPRESSED;
+    if (!m_compressed) {
+        m_buffer = m_data.mid(HEADER_SIZE);
+        m_pos = m_data.size();
+    }
+}
+
+/* make sure n more bytes of the record stream are buffered */
+bool VdomBinaryReader::ensure(int n) {
+    while (m_buffer.size() - m_bufferPos < n) {
+        if (!m_compressed || m_pos + 4 > m_data.size()) {
+            return false;
+        }
+        const uchar* p = reinterpret_cast<const uchar*>(m_data.constData()) + m_pos;
+        quint32 len = (quint32(p[0]) << 24) | (quint32(p[1]) << 16) |
+            (quint32(p[2]) << 8) | quint32(p[3]);
+        m_pos += 4;
+        if (len > quint32(m_data.size() - m_pos)) {
+            m_errorString = "Corrupt compressed chunk";
+            return false;
+        }
+        QByteArray chunk = qUncompress(
+                reinterpret_cast<const uchar*>(m_data.constData()) + m_pos, len);
+        m_pos += len;
+        if (chunk.isEmpty()) {
+            /* the last chunk may have been the bad one */
+            m_errorString = "Corrupt compressed chunk";
+            return false;
+        }
+        m_buffer = m_buffer.mid(m_bufferPos) + chunk;
+        m_bufferPos = 0;
+    }
+    return true;
+}
+
+bool VdomBinaryReader::readVarint(quint32& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (!ensure(1))
+            return false;
+        uchar c = m_buffer[m_bufferPos++];
+        value |= quint32(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return true;
+    }
+    return false;
+}
+
+VdomBinaryReader::Token VdomBinaryReader::fail(const QString& error) {
+    /* a corrupt chunk is what made the record fall short */
+    if (m_errorString.isEmpty())
+        m_errorString = error;
+    m_buffer.clear();
+    m_bufferPos = 0;
+    m_pos = m_data.size();
+    return Error;
+}
+
+VdomBinaryReader::Token VdomBinaryReader::next() {
+    if (!m_errorString.isEmpty()) {
+        return Error;
+    }
+    if (!ensure(1)) {
+        if (!m_errorString.isEmpty() || m_pos < m_data.size()) {
+            return fail("Corrupt compressed chunk");
+        }
+        return End;
+    }
+
+    quint32 len;
+    uchar op = m_buffer[m_bufferPos++];
+    switch (op) {
+    case OP_NEW:
+    case OP_LIT:
+        /* a length from a corrupt dump must not wrap around in ensure() */
+        if (!readVarint(len) || len > quint32(INT_MAX) || !ensure(int(len)))
+            return fail("Truncated string");
+        m_string = m_buffer.mid(m_bufferPos, len);
+        m_bufferPos += len;
+        if (op == OP_NEW)
+            m_table.append(m_string);
+        return String;
+    case OP_STR:
+        if (!readVarint(len))
+            return fail("Truncated string reference");
+        if (len >= quint32(m_table.count()))
+            return fail(QString("String %1 not defined").arg(len));
+        m_string = m_table[len];
+        return String;
+    case OP_INT: {
+        if (!ensure(4))
+            return fail("Truncated integer");
+        const uchar* p = reinterpret_cast<const uchar*>(m_buffer.constData()) + m_bufferPos;
+        m_integer = qint32(quint32(p[0]) | (quint32(p[1]) << 8) |
+                (quint32(p[2]) << 16) | (quint32(p[3]) << 24));
+        m_bufferPos += 4;
+        return Integer;
+    }
+    case OP_EOL:
+        return EndOfLine;
+    default:
+        return fail(QString("Unknown opcode 0x%1").arg(op, 2, 16, QChar('0')));
+    }
+}
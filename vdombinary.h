@@ -0,0 +1,102 @@
+#ifndef VDOM_BINARY_H
+#define VDOM_BINARY_H
+
+#include <QtCore>
+
+/* A compact binary encoding ("VDB") of the text VDOM dumps.
+ *
+ * The encoding makes no assumptions about the dump syntax. Every line
+ * is cut into runs of text and canonical decimal integers; integers
+ * that fit become fixed-width int32s, and text runs are interned into
+ * a string table which both sides build while streaming, so repeated
+ * tag names, class names and styles cost a few bytes each. Decoding
+ * reproduces the text dump byte for byte.
+ *
+ * Layout:
+ *
+ *   "VDB1"     magic
+ *   u8         flags, bit 0: the record stream is compressed
+ *   u8[3]      reserved, 0
+ *   records    the record stream, either raw or as a sequence of
+ *              chunks of "u32 big-endian length, qCompress() data"
+ *              (qCompress() data is a u32 big-endian uncompressed
+ *              size followed by a zlib stream)
+ *
+ * Records start with an opcode byte:
+ *
+ *   0x01 NEW  varint length, bytes: a new string, which also gets the
+ *             next index in the string table (starting at 0)
+ *   0x02 STR  varint index: a string from the table
+ *   0x03 INT  int32 little-endian
+ *   0x04 EOL  end of line
+ *   0x05 LIT  varint length, bytes: a string not put in the table
+ *
+ * Varints are unsigned LEB128. Perl hunters can read VDB dumps with
+ * hunter/VdomDump.pm. */
+class VdomBinary {
+public:
+    enum DumpFormat {
+        TextDump = 0,
+        BinaryDump = 1,
+        CompressedBinaryDump = 2
+    };
+
+    /* encode a text dump in the given format */
+    static QByteArray encode(const QByteArray& text, int format);
+
+    static bool isBinary(const QByteArray& data);
+
+    /* back to the text dump */
+    static bool decode(const QByteArray& data, QByteArray& text, QString& errorString);
+};
+
+/* Pulls the tokens of a VDB dump one at a time, decompressing chunk
+ * by chunk, without rebuilding the text. */
+class VdomBinaryReader {
+public:
+    enum Token {
+        String,
+        Integer,
+        EndOfLine,
+        End,
+        Error
+    };
+
+    VdomBinaryReader(const QByteArray& data);
+
+    Token next();
+
+    /* the current String token */
+    const QByteArray& string() const {
+        return m_string;
+    }
+
+    /* the current Integer token */
+    qint32 integer() const {
+        return m_integer;
+    }
+
+    const QString& errorString() const {
+        return m_errorString;
+    }
+
+private:
+    bool ensure(int n);
+    bool readVarint(quint32& value);
+    Token fail(const QString& error);
+
+    QByteArray m_data;
+    int m_pos;
+    bool m_compressed;
+
+    /* the decoded record stream not consumed yet */
+    QByteArray m_buffer;
+    int m_bufferPos;
+
+    QList<QByteArray> m_table;
+    QByteArray m_string;
+    qint32 m_integer;
+    QString m_errorString;
+};
+
+#endif // VDOM_BINARY_H
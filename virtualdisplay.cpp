@@ -0,0 +1,112 @@
+#include "virtualdisplay.h"
+
+#include <cstring>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef Q_OS_LINUX
+#include <sys/prctl.h>
+#endif
+
+const static int FIRST_DISPLAY = 99;
+const static int MAX_DISPLAYS = 100;
+/* ms for the server to come up */
+const static int START_TIMEOUT = 10000;
+const static int POLL_INTERVAL = 50;
+
+VirtualDisplay* VirtualDisplay::s_running = 0;
+
+/* exit() skips the destructors of main()'s locals */
+void VirtualDisplay::stopAtExit() {
+    if (s_running) {
+        s_running->stop();
+    }
+}
+
+VirtualDisplay::VirtualDisplay()
+    : m_pid(-1), m_display(-1)
+{
+}
+
+VirtualDisplay::~VirtualDisplay() {
+    stop();
+}
+
+bool VirtualDisplay::start(QString& errorString) {
+    for (int display = FIRST_DISPLAY; display < FIRST_DISPLAY + MAX_DISPLAYS; display++) {
+        /* the lock file of a running server, or one that died badly */
+        if (QFile::exists(QString("/tmp/.X%1-lock").arg(display)))
+            continue;
+        QByteArray name = ":" + QByteArray::number(display);
+        QByteArray socket = "/tmp/.X11-unix/X" + QByteArray::number(display);
+
+        pid_t parent = getpid();
+        pid_t pid = fork();
+        if (pid < 0) {
+            errorString = QString("Failed to fork Xvfb: %1").arg(strerror(errno));
+            return false;
+        }
+        if (pid == 0) {
+#ifdef Q_OS_LINUX
+            /* not even a crash of ours may leave it behind */
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            if (getppid() != parent) {
+                _exit(1);
+            }
+#endif
+            execlp("Xvfb", "Xvfb", name.constData(),
+                   "-screen", "0", "1280x1024x24", "-nolisten", "tcp",
+                   (char*) 0);
+            _exit(127);
+        }
+
+        for (int waited = 0; waited < START_TIMEOUT; waited += POLL_INTERVAL) {
+            int status;
+            if (waitpid(pid, &status, WNOHANG) == pid) {
+                if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+                    errorString = "Failed to run Xvfb; is it installed?";
+                    return false;
+                }
+                /* lost the race for this display to someone else */
+                pid = -1;
+                break;
+            }
+            if (QFile::exists(QString::fromLatin1(socket))) {
+                m_pid = pid;
+                m_display = display;
+                static bool registered = false;
+                if (!registered) {
+                    atexit(stopAtExit);
+                    registered = true;
+                }
+                s_running = this;
+                setenv("DISPLAY", name.constData(), 1);
+                return true;
+            }
+            usleep(POLL_INTERVAL * 1000);
+        }
+        if (pid > 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, 0, 0);
+            errorString = QString("Xvfb did not come up on display %1").arg(QString(name));
+            return false;
+        }
+    }
+    errorString = "No free X display number for Xvfb";
+    return false;
+}
+
+void VirtualDisplay::stop() {
+    if (m_pid <= 0) {
+        return;
+    }
+    kill(m_pid, SIGTERM);
+    waitpid(m_pid, 0, 0);
+    m_pid = -1;
+    m_display = -1;
+    if (s_running == this) {
+        s_running = 0;
+    }
+}
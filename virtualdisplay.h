@@ -0,0 +1,38 @@
+#ifndef VIRTUAL_DISPLAY_H
+#define VIRTUAL_DISPLAY_H
+
+#include <QtCore>
+#include <sys/types.h>
+
+/* A private Xvfb server for running without an X display.
+ *
+ * QtWebKit on Qt 4 needs an X connection for fonts even when no widget
+ * is ever shown. start() runs Xvfb on the first free display number
+ * from FIRST_DISPLAY on, waits for its socket and points DISPLAY at
+ * it, so it has to be called before the QApplication is created. The
+ * server is killed when the object goes away or the program exit()s,
+ * and on Linux also when the program dies; child processes started
+ * in between (e.g. the workers of a coordinator) share it. */
+class VirtualDisplay {
+public:
+    VirtualDisplay();
+    ~VirtualDisplay();
+
+    bool start(QString& errorString);
+    void stop();
+
+    int display() const {
+        return m_display;
+    }
+
+private:
+    static void stopAtExit();
+
+    /* the one started, for stopAtExit() */
+    static VirtualDisplay* s_running;
+
+    pid_t m_pid;
+    int m_display;
+};
+
+#endif // VIRTUAL_DISPLAY_H
@@ -0,0 +1,154 @@
+#include "webarchive.h"
+#include "logger.h"
+
+WebArchive::WebArchive() {
+}
+
+bool WebArchive::open(const QString& dir, bool writable) {
+    m_dir = QDir(dir);
+    m_index.clear();
+    m_indexFile.close();
+
+    if (writable && !m_dir.mkpath("objects")) {
+        m_errorString = QString("Cannot create directory %1/objects").arg(dir);
+        return false;
+    }
+
+    m_indexFile.setFileName(m_dir.filePath("index"));
+    if (m_indexFile.open(QIODevice::ReadOnly)) {
+        while (!m_indexFile.atEnd()) {
+            QByteArray line = m_indexFile.readLine();
+            if (line.endsWith('\n'))
+                line.chop(1);
+            QList<QByteArray> fields = line.split('\t');
+            if (fields.count() != 3) {
+                continue;
+            }
+            Entry entry;
+            entry.headers = fields[1];
+            entry.body = fields[2];
+            m_index.insert(fields[0], entry);
+        }
+        m_indexFile.close();
+    } else if (!writable) {
+        m_errorString = QString("Cannot read archive index %1: %2")
+            .arg(m_indexFile.fileName()).arg(m_indexFile.errorString());
+        return false;
+    }
+
+    if (writable && !m_indexFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        m_errorString = QString("Cannot write archive index %1: %2")
+            .arg(m_indexFile.fileName()).arg(m_indexFile.errorString());
+        return false;
+    }
+    return true;
+}
+
+QByteArray WebArchive::key(const QUrl& url) {
+    return url.toEncoded(QUrl::RemoveFragment);
+}
+
+bool WebArchive::find(const QUrl& url, Response& response) const {
+    QHash<QByteArray, Entry>::const_iterator it = m_index.constFind(key(url));
+    if (it == m_index.constEnd()) {
+        return false;
+    }
+
+    QByteArray headers;
+    if (!readObject(it.value().headers, headers) ||
+            !readObject(it.value().body, response.body)) {
+        return false;
+    }
+
+    QList<QByteArray> lines = headers.split('\n');
+    if (lines.isEmpty()) {
+        return false;
+    }
+    const QByteArray& statusLine = lines.first();
+    int sp = statusLine.indexOf(' ');
+    response.status = statusLine.left(sp).toInt();
+    response.reason = sp < 0 ? QByteArray() : statusLine.mid(sp + 1);
+    response.headers.clear();
+    for (int i = 1; i < lines.count(); i++) {
+        int colon = lines[i].indexOf(':');
+        if (colon <= 0)
+            continue;
+        QByteArray name = lines[i].left(colon);
+        QByteArray value = lines[i].mid(colon + 1).trimmed();
+        int j = 0;
+        while (j < response.headers.count() && response.headers[j].first != name)
+            j++;
+        if (j < response.headers.count()) {
+            response.headers[j].second += '\n' + value;
+        } else {
+            response.headers.append(qMakePair(name, value));
+        }
+    }
+    return true;
+}
+
+bool WebArchive::store(const QUrl& url, const Response& response) {
+    if (!m_indexFile.isOpen()) {
+        return false;
+    }
+
+    QByteArray headers = QByteArray::number(response.status) + ' ' + response.reason;
+    for (int i = 0; i < response.headers.count(); i++) {
+        /* QNetworkReply joins repeated headers (Set-Cookie) with
+         * newlines; keep them one per line */
+        QList<QByteArray> values = response.headers[i].second.split('\n');
+        for (int j = 0; j < values.count(); j++) {
+            headers += '\n' + response.headers[i].first + ": " + values[j];
+        }
+    }
+
+    Entry entry;
+    entry.headers = writeObject(headers);
+    entry.body = writeObject(response.body);
+    if (entry.headers.isEmpty() || entry.body.isEmpty()) {
+        return false;
+    }
+
+    QByteArray k = key(url);
+    m_index.insert(k, entry);
+    m_indexFile.write(k + '\t' + entry.headers + '\t' + entry.body + '\n');
+    m_indexFile.flush();
+    return true;
+}
+
+QByteArray WebArchive::writeObject(const QByteArray& data) {
+    QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+    QString path = m_dir.filePath("objects/" + QString::fromLatin1(hash));
+    if (QFile::exists(path)) {
+        return hash;
+    }
+
+    /* write under a temporary name first, so that a crash never
+     * leaves a truncated object behind */
+    QString tmpPath = path + ".tmp";
+    QFile file(tmpPath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+        m_errorString = QString("Cannot write %1: %2").arg(tmpPath).arg(file.errorString());
+        VDOM_LOG(Network, Warning, m_errorString);
+        file.remove();
+        return QByteArray();
+    }
+    file.close();
+    if (!QFile::rename(tmpPath, path)) {
+        QFile::remove(tmpPath);
+        if (!QFile::exists(path)) {
+            return QByteArray();
+        }
+    }
+    return hash;
+}
+
+bool WebArchive::readObject(const QByteArray& hash, QByteArray& data) const {
+    QFile file(m_dir.filePath("objects/" + QString::fromLatin1(hash)));
+    if (!file.open(QIODevice::ReadOnly)) {
+        VDOM_LOG(Network, Warning, "Missing archive object " + file.fileName());
+        return false;
+    }
+    data = file.readAll();
+    return true;
+}
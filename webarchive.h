@@ -0,0 +1,69 @@
+#ifndef WEB_ARCHIVE_H
+#define WEB_ARCHIVE_H
+
+#include <QtCore>
+
+/* An on-disk archive of HTTP responses for recording and replaying
+ * page loads.
+ *
+ * Layout of the archive directory:
+ *
+ *   objects/<sha1>   response bodies and header blocks, named by the
+ *                    SHA-1 of their content, so identical resources
+ *                    (e.g. a script shared by every page of a site)
+ *                    are stored once
+ *   index            one line per response, appended as recorded:
+ *                    "<url>\t<header sha1>\t<body sha1>"; a later
+ *                    line for the same URL wins
+ *
+ * A header block is the status line "<code> <reason>" followed by
+ * "Name: value" lines. */
+class WebArchive {
+public:
+    struct Response {
+        Response() : status(0) {}
+
+        int status;
+        QByteArray reason;
+        QList<QPair<QByteArray, QByteArray> > headers;
+        QByteArray body;
+    };
+
+    WebArchive();
+
+    /* Open (and for recording, create) the archive in the directory. */
+    bool open(const QString& dir, bool writable);
+
+    const QString& errorString() const {
+        return m_errorString;
+    }
+
+    int count() const {
+        return m_index.count();
+    }
+
+    bool contains(const QUrl& url) const {
+        return m_index.contains(key(url));
+    }
+
+    bool find(const QUrl& url, Response& response) const;
+    bool store(const QUrl& url, const Response& response);
+
+private:
+    struct Entry {
+        QByteArray headers;
+        QByteArray body;
+    };
+
+    static QByteArray key(const QUrl& url);
+
+    QByteArray writeObject(const QByteArray& data);
+    bool readObject(const QByteArray& hash, QByteArray& data) const;
+
+    QDir m_dir;
+    QFile m_indexFile;
+    QHash<QByteArray, Entry> m_index;
+    QString m_errorString;
+};
+
+#endif // WEB_ARCHIVE_H
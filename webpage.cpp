@@ -1,9 +1,12 @@
 #include "webpage.h"
 #include "mainwindow.h"
+#include <qwebframe.h>
 #include <QtUiTools/QUiLoader>
 
 QWebPage *WebPage::createWindow(QWebPage::WebWindowType)
 {
+    if (m_headless)
+        return 0;
     MainWindow *mw = new MainWindow;
     mw->show();
     return mw->webPage();
@@ -14,13 +17,27 @@ QObject *WebPage::createPlugin(const QString &classId, const QUrl &url, const QS
     Q_UNUSED(url);
     Q_UNUSED(paramNames);
     Q_UNUSED(paramValues);
+    if (m_headless)
+        return 0;
     QUiLoader loader;
     return loader.createWidget(classId, view());
 }
 
 void WebPage::javaScriptConsoleMessage ( const QString & message, int lineNumber, const QString & sourceID ) {
-    qDebug() << "[Error Console] " << sourceID << ": line " << lineNumber <<
-        ": " << message << endl;
+    if (!Logger::isEnabled(Logger::Console, Logger::Info))
+        return;
+    /* a page logging in a loop must not drown the others */
+    if (!m_consoleLimiter.allow())
+        return;
+    QString page = mainFrame()->url().toString();
+    int dropped = m_consoleLimiter.takeDropped();
+    if (dropped > 0) {
+        Logger::instance()->log(Logger::Console, Logger::Warning,
+                QString("%1 console messages dropped").arg(dropped), page);
+    }
+    Logger::instance()->log(Logger::Console, Logger::Info,
+            QString("%1: line %2: %3").arg(sourceID).arg(lineNumber).arg(message),
+            page);
 }
 
 QString WebPage::userAgentForUrl(const QUrl& url) const {
@@ -35,3 +52,30 @@ void WebPage::setUserAgent(const QString& userAgent) {
     m_userAgent = userAgent;
 }
 
+void WebPage::forceLayout() {
+    /* render() lays out all frames before painting the clip. The clip
+     * must not be empty: Qt 4.6 then returns before the layout, and
+     * later versions paint the whole page instead. One pixel costs
+     * next to nothing, and works with JavaScript off too. */
+    QImage image(1, 1, QImage::Format_RGB32);
+    QPainter painter(&image);
+    mainFrame()->render(&painter, QRegion(0, 0, 1, 1));
+}
+
+
+bool WebPage::acceptNavigationRequest(QWebFrame* frame, const QNetworkRequest& request, NavigationType type) {
+    if (!QWebPage::acceptNavigationRequest(frame, request, type)) {
+        return false;
+    }
+    if (frame && frame == mainFrame()) {
+        /* a jump to a fragment loads no new document */
+        bool sameDocument = type != NavigationTypeReload &&
+            request.url().hasFragment() &&
+            request.url().toString(QUrl::RemoveFragment) ==
+                mainFrame()->url().toString(QUrl::RemoveFragment);
+        if (!sameDocument) {
+            m_network->setNextPage(request.url());
+        }
+    }
+    return true;
+}
@@ -2,19 +2,64 @@
 #define WEBPAGE_H
 
 #include <qwebpage.h>
+#include <qwebframe.h>
+
+#include "networkaccessmanager.h"
+#include "readinessmonitor.h"
+#include "logger.h"
 
 class WebPage : public QWebPage
 {
 public:
-    WebPage(QWidget *parent) : QWebPage(parent) {}
+    WebPage(QWidget *parent) : QWebPage(parent), m_headless(false) {
+        /* archive record/replay and request filtering */
+        m_network = new NetworkAccessManager(this);
+        setNetworkAccessManager(m_network);
+        /* budgets start over when a new document starts loading, not
+         * on navigation requests which may be refused or stay within
+         * the document */
+        m_network->setMainFrame(mainFrame());
+#if QT_VERSION >= 0x040600
+        connect(mainFrame(), SIGNAL(loadStarted()), m_network, SLOT(startPage()));
+#else
+        connect(this, SIGNAL(loadStarted()), m_network, SLOT(startPage()));
+#endif
+        m_readiness = new ReadinessMonitor(this, m_network);
+    }
 
     virtual QWebPage *createWindow(QWebPage::WebWindowType);
     virtual QObject* createPlugin(const QString&, const QUrl&, const QStringList&, const QStringList&);
     virtual void javaScriptConsoleMessage(const QString& message, int lineNumber, const QString& sourceID);
     virtual QString userAgentForUrl(const QUrl& url) const;
+    virtual bool acceptNavigationRequest(QWebFrame* frame, const QNetworkRequest& request, NavigationType type);
     void setUserAgent(const QString& userAgent);
+
+    /* Lay the page out for its viewport now, as a view would right
+     * before painting. Pages without a view are never painted, so
+     * without this QWebVDom may read a stale render tree. */
+    void forceLayout();
+
+    /* headless pages (used by the batch crawler) never open new
+     * browser windows nor instantiate plugin widgets */
+    void setHeadless(bool headless) {
+        m_headless = headless;
+    }
+
+    bool isHeadless() const {
+        return m_headless;
+    }
+
+    /* dump the page on its ready() rather than on loadFinished() */
+    ReadinessMonitor* readiness() const {
+        return m_readiness;
+    }
+
 private:
+    NetworkAccessManager* m_network;
+    ReadinessMonitor* m_readiness;
     QString m_userAgent;
+    bool m_headless;
+    LogRateLimiter m_consoleLimiter;
 };
 
 #endif
@@ -7,6 +7,13 @@ WebView::WebView(QWidget *parent)
     setPage(m_page);
 }
 
+void WebView::setWebPage(WebPage* page)
+{
+    page->setParent(this);
+    m_page = page;
+    setPage(page);
+}
+
 void WebView::contextMenuEvent(QContextMenuEvent *event)
 {
     QMenu *menu = new QMenu(this);
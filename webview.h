@@ -20,6 +20,10 @@ public:
 
     WebPage *webPage() const { return m_page; }
 
+    /* Show another page; the view takes it over and deletes the
+     * current one. */
+    void setWebPage(WebPage* page);
+
 signals:
     void showImageFieldDialog();
     void showTextFieldDialog();
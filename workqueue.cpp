@@ -0,0 +1,402 @@
+#include "workqueue.h"
+#include "logger.h"
+
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+/* how long a remote worker waits for the broker */
+const static int CONNECT_TIMEOUT = 10000;
+const static int BROKER_TIMEOUT = 120000;
+
+static QList<QByteArray> stateLines(const QByteArray& data) {
+    QList<QByteArray> lines = data.split('\n');
+    for (int i = lines.count() - 1; i >= 0; i--) {
+        if (lines[i].trimmed().isEmpty())
+            lines.removeAt(i);
+    }
+    return lines;
+}
+
+static QByteArray joinLines(const QList<QByteArray>& lines) {
+    QByteArray data;
+    for (int i = 0; i < lines.count(); i++) {
+        data += lines[i];
+        data += '\n';
+    }
+    return data;
+}
+
+/* statuses go into one tab-separated line */
+static QByteArray cleanStatus(const QString& status) {
+    QByteArray s = status.toUtf8();
+    s.replace('\n', ' ');
+    s.replace('\r', ' ');
+    s.replace('\t', ' ');
+    return s;
+}
+
+static bool parseUrl(const QString& qstr, QUrl& url) {
+    url = QUrl();
+    url.setEncodedUrl(qstr.toUtf8(), QUrl::StrictMode);
+    return url.isValid();
+}
+
+FileWorkQueue::FileWorkQueue(const QString& dir, const QString& workerId)
+    : m_dir(dir), m_workerId(workerId), m_lockFd(-1), m_valid(false)
+{
+    if (m_workerId.isEmpty()) {
+        m_workerId = QString("%1-%2").arg(QHostInfo::localHostName()).arg(getpid());
+    }
+    QString lockPath = m_dir + "/lock";
+    m_lockFd = ::open(QFile::encodeName(lockPath).constData(), O_RDWR | O_CREAT, 0644);
+    if (m_lockFd < 0) {
+        m_errorString = QString("Failed to open %1: %2")
+            .arg(lockPath).arg(QString::fromLocal8Bit(strerror(errno)));
+        return;
+    }
+    QString listFile = QString::fromUtf8(readState("list").trimmed());
+    if (listFile.isEmpty()) {
+        m_errorString = QString("%1 holds no work queue").arg(m_dir);
+        return;
+    }
+    if (!m_urls.open(listFile)) {
+        m_errorString = QString("Failed to load url list file %1: %2")
+            .arg(listFile).arg(m_urls.errorString());
+        return;
+    }
+    m_valid = true;
+}
+
+FileWorkQueue::~FileWorkQueue() {
+    if (m_lockFd >= 0) {
+        ::close(m_lockFd);
+    }
+}
+
+bool FileWorkQueue::create(const QString& dir, const QString& listFile,
+                           QString& errorString) {
+    if (!QDir().mkpath(dir + "/leases")) {
+        errorString = QString("Failed to create queue directory %1").arg(dir);
+        return false;
+    }
+    /* before anything is requeued: the leases may be those of another
+     * coordinator's workers */
+    if (!lockCoordinator(dir, errorString)) {
+        return false;
+    }
+    QString old = QString::fromUtf8(readFile(dir + "/list").trimmed());
+    QString list = listFile.isEmpty() ? old : QFileInfo(listFile).absoluteFilePath();
+    if (list.isEmpty()) {
+        errorString = QString("%1 holds no work queue to resume").arg(dir);
+        return false;
+    }
+    if (!old.isEmpty() && old != list) {
+        errorString = QString("%1 already holds the queue of %2").arg(dir).arg(old);
+        return false;
+    }
+
+    QFile file(dir + "/list");
+    if (old.isEmpty() && (!file.open(QIODevice::WriteOnly) ||
+            file.write(list.toUtf8() + "\n") == -1)) {
+        errorString = QString("Failed to write %1: %2")
+            .arg(file.fileName()).arg(file.errorString());
+        return false;
+    }
+    file.close();
+
+    FileWorkQueue queue(dir, "coordinator");
+    if (!queue.isValid()) {
+        errorString = queue.errorString();
+        return false;
+    }
+    /* resuming: whoever held these is gone */
+    QStringList workers = QDir(dir + "/leases").entryList(QDir::Files);
+    int requeued = 0;
+    for (int i = 0; i < workers.count(); i++) {
+        requeued += queue.requeue(workers[i]);
+    }
+    if (requeued > 0) {
+        VDOM_LOG(Batch, Info, QString("Resuming queue %1: %2 leased URLs requeued")
+                .arg(dir).arg(requeued));
+    }
+    return true;
+}
+
+/* The lock is never released; it goes with the process. */
+bool FileWorkQueue::lockCoordinator(const QString& dir, QString& errorString) {
+    QString path = dir + "/coordinator";
+    int fd = ::open(QFile::encodeName(path).constData(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        errorString = QString("Failed to open %1: %2")
+            .arg(path).arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    /* the workers we start must not keep it after we are gone */
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    while (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        if (errno == EINTR)
+            continue;
+        if (errno == EWOULDBLOCK) {
+            errorString = QString("%1 is coordinated by another process already").arg(dir);
+        } else {
+            errorString = QString("Failed to lock %1: %2")
+                .arg(path).arg(QString::fromLocal8Bit(strerror(errno)));
+        }
+        ::close(fd);
+        return false;
+    }
+    return true;
+}
+
+QByteArray FileWorkQueue::readFile(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+bool FileWorkQueue::lock() {
+    while (flock(m_lockFd, LOCK_EX) < 0) {
+        if (errno != EINTR) {
+            m_errorString = QString("Failed to lock %1: %2")
+                .arg(m_dir).arg(QString::fromLocal8Bit(strerror(errno)));
+            m_valid = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+void FileWorkQueue::unlock() {
+    flock(m_lockFd, LOCK_UN);
+}
+
+QByteArray FileWorkQueue::readState(const QString& name) const {
+    return readFile(m_dir + "/" + name);
+}
+
+/* Replace a state file atomically, so a reader never sees it half
+ * written even if we die right here. */
+bool FileWorkQueue::writeState(const QString& name, const QByteArray& data) {
+    QString path = m_dir + "/" + name;
+    QString tmp = QString("%1.tmp-%2").arg(path).arg(getpid());
+    QFile file(tmp);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) == -1) {
+        m_errorString = QString("Failed to write %1: %2")
+            .arg(tmp).arg(file.errorString());
+        return false;
+    }
+    file.close();
+    if (::rename(QFile::encodeName(tmp).constData(),
+                 QFile::encodeName(path).constData()) < 0) {
+        m_errorString = QString("Failed to rename %1: %2")
+            .arg(tmp).arg(QString::fromLocal8Bit(strerror(errno)));
+        QFile::remove(tmp);
+        return false;
+    }
+    return true;
+}
+
+bool FileWorkQueue::appendState(const QString& name, const QByteArray& data) {
+    QFile file(m_dir + "/" + name);
+    /* a single write() with O_APPEND */
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered) ||
+            file.write(data) == -1) {
+        m_errorString = QString("Failed to append to %1: %2")
+            .arg(file.fileName()).arg(file.errorString());
+        return false;
+    }
+    return true;
+}
+
+QString FileWorkQueue::leaseFile(const QString& workerId) const {
+    return "leases/" + workerId;
+}
+
+bool FileWorkQueue::nextUrl(QUrl& url, int& index) {
+    return lease(m_workerId, url, index);
+}
+
+void FileWorkQueue::complete(int index, const QString& status) {
+    complete(m_workerId, index, status);
+}
+
+bool FileWorkQueue::lease(const QString& workerId, QUrl& url, int& index) {
+    if (!m_valid || !lock()) {
+        return false;
+    }
+    for (;;) {
+        QList<QByteArray> requeued = stateLines(readState("requeue"));
+        bool fromRequeue = !requeued.isEmpty();
+        int attempts = 1;
+        if (fromRequeue) {
+            QList<QByteArray> fields = requeued.takeFirst().split(' ');
+            index = fields[0].toInt();
+            attempts = fields.value(1).toInt() + 1;
+        } else {
+            index = readState("next").trimmed().toInt();
+        }
+        /* only blocks if we are ahead of the background indexer */
+        bool exists = m_urls.waitForCount(index + 1);
+        if (!exists && !fromRequeue) {
+            unlock();
+            return false;
+        }
+
+        /* Lease before moving on: dying in between leaves the URL
+         * leased and queued, so it is crawled twice but never lost. */
+        bool ok = exists && parseUrl(m_urls.at(index), url);
+        if (ok) {
+            ok = appendState(leaseFile(workerId),
+                    QByteArray::number(index) + ' ' + QByteArray::number(attempts) + '\n');
+            if (!ok) {
+                m_valid = false;
+                unlock();
+                return false;
+            }
+        } else if (exists) {
+            VDOM_LOG(Batch, Warning, "Skipping invalid URL " + m_urls.at(index));
+            appendState("done", QByteArray::number(index) + "\tinvalid\n");
+        }
+        bool written = fromRequeue
+            ? writeState("requeue", joinLines(requeued))
+            : writeState("next", QByteArray::number(index + 1) + '\n');
+        if (!written) {
+            m_valid = false;
+            unlock();
+            return false;
+        }
+        if (ok) {
+            unlock();
+            return true;
+        }
+    }
+}
+
+void FileWorkQueue::complete(const QString& workerId, int index, const QString& status) {
+    if (!m_valid || !lock()) {
+        return;
+    }
+    appendState("done", QByteArray::number(index) + '\t' + cleanStatus(status) + '\n');
+    QList<QByteArray> leases = stateLines(readState(leaseFile(workerId)));
+    for (int i = 0; i < leases.count(); i++) {
+        if (leases[i].split(' ').value(0).toInt() == index) {
+            leases.removeAt(i);
+            break;
+        }
+    }
+    writeState(leaseFile(workerId), joinLines(leases));
+    unlock();
+}
+
+int FileWorkQueue::requeue(const QString& workerId) {
+    if (!m_valid || !lock()) {
+        return 0;
+    }
+    QList<QByteArray> leases = stateLines(readState(leaseFile(workerId)));
+    QByteArray requeued;
+    QByteArray crashed;
+    for (int i = 0; i < leases.count(); i++) {
+        QList<QByteArray> fields = leases[i].split(' ');
+        if (fields.value(1).toInt() >= maxAttempts()) {
+            /* keeps killing its workers */
+            crashed += fields[0] + "\tcrashed\n";
+        } else {
+            requeued += leases[i] + '\n';
+        }
+    }
+    if (!crashed.isEmpty()) {
+        appendState("done", crashed);
+    }
+    if (!requeued.isEmpty()) {
+        appendState("requeue", requeued);
+    }
+    QFile::remove(m_dir + "/" + leaseFile(workerId));
+    unlock();
+    return requeued.count('\n');
+}
+
+bool FileWorkQueue::isFinished() {
+    if (!m_valid || !lock()) {
+        return true;
+    }
+    bool finished = stateLines(readState("requeue")).isEmpty() &&
+        !m_urls.waitForCount(readState("next").trimmed().toInt() + 1);
+    QStringList workers = QDir(m_dir + "/leases").entryList(QDir::Files);
+    for (int i = 0; finished && i < workers.count(); i++) {
+        if (!stateLines(readState(leaseFile(workers[i]))).isEmpty())
+            finished = false;
+    }
+    unlock();
+    return finished;
+}
+
+RemoteWorkQueue::RemoteWorkQueue(const QString& address)
+    : m_valid(false)
+{
+    int colon = address.lastIndexOf(':');
+    bool ok = false;
+    quint16 port = colon < 0 ? 0 : address.mid(colon + 1).toUShort(&ok);
+    if (!ok) {
+        m_errorString = QString("Invalid queue address %1, expected host:port").arg(address);
+        return;
+    }
+    m_socket.connectToHost(address.left(colon), port);
+    if (!m_socket.waitForConnected(CONNECT_TIMEOUT)) {
+        m_errorString = QString("Failed to connect to the queue broker at %1: %2")
+            .arg(address).arg(m_socket.errorString());
+        return;
+    }
+    m_valid = true;
+}
+
+bool RemoteWorkQueue::readLine(QByteArray& line) {
+    while (!m_socket.canReadLine()) {
+        if (!m_socket.waitForReadyRead(BROKER_TIMEOUT)) {
+            m_errorString = QString("Lost the queue broker: %1").arg(m_socket.errorString());
+            m_valid = false;
+            return false;
+        }
+    }
+    line = m_socket.readLine().trimmed();
+    return true;
+}
+
+bool RemoteWorkQueue::nextUrl(QUrl& url, int& index) {
+    if (!m_valid) {
+        return false;
+    }
+    m_socket.write("LEASE\n");
+    QByteArray line;
+    if (!readLine(line)) {
+        return false;
+    }
+    if (line == "DRAINED") {
+        return false;
+    }
+    QList<QByteArray> fields = line.split(' ');
+    bool ok = false;
+    if (fields.count() == 3 && fields[0] == "URL") {
+        index = fields[1].toInt(&ok);
+        url = QUrl::fromEncoded(fields[2], QUrl::StrictMode);
+    }
+    if (!ok || !url.isValid()) {
+        m_errorString = QString("Unexpected answer from the queue broker: %1")
+            .arg(QString::fromUtf8(line));
+        m_valid = false;
+        return false;
+    }
+    return true;
+}
+
+void RemoteWorkQueue::complete(int index, const QString& status) {
+    if (!m_valid) {
+        return;
+    }
+    m_socket.write("DONE " + QByteArray::number(index) + ' ' + cleanStatus(status) + '\n');
+    m_socket.flush();
+}
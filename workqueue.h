@@ -0,0 +1,137 @@
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <QtCore>
+#include <QtNetwork>
+
+#include "urllist.h"
+
+/* Where the jobs of a BatchCrawler get their URLs from. Every URL
+ * handed out by nextUrl() is a lease, given back by complete() once
+ * its page is done. Queues shared between processes put the leases
+ * of a process that died back into the queue, so every URL is
+ * crawled at least once; one that was being worked on when its
+ * process died may be crawled twice. */
+class WorkQueue {
+public:
+    virtual ~WorkQueue() {}
+
+    virtual bool isValid() const = 0;
+    virtual QString errorString() const = 0;
+
+    /* Lease the next valid URL and its index in the list file.
+     * Returns false when the queue is drained. */
+    virtual bool nextUrl(QUrl& url, int& index) = 0;
+
+    virtual void complete(int index, const QString& status) {
+        Q_UNUSED(index);
+        Q_UNUSED(status);
+    }
+};
+
+/* A work queue kept in a directory, shared by the processes of one
+ * machine and safe against any of them dying at any point. All state
+ * changes happen under an flock() on <dir>/lock:
+ *
+ *   list            path of the URL list file
+ *   next            index of the first URL never leased
+ *   requeue         "<index> <attempts>" lines taken back from dead
+ *                   workers, leased before anything new
+ *   leases/<id>     "<index> <attempts>" lines leased by worker <id>
+ *   done            "<index>\t<status>" log of the completed URLs
+ *   coordinator     flock()ed by the coordinator of the queue for as
+ *                   long as it runs
+ *
+ * A URL whose worker died maxAttempts() times is completed as
+ * "crashed" instead of being leased again. */
+class FileWorkQueue : public WorkQueue {
+public:
+    /* the worker id defaults to <host>-<pid> */
+    FileWorkQueue(const QString& dir, const QString& workerId = QString());
+    ~FileWorkQueue();
+
+    /* Set up the queue for the list file in dir and become its only
+     * coordinator until the process exits; fails if another process
+     * coordinates it already. A queue left there for the same list is
+     * resumed: all its leases are put back, as no worker can be
+     * running without a coordinator. */
+    static bool create(const QString& dir, const QString& listFile,
+                       QString& errorString);
+
+    virtual bool isValid() const {
+        return m_valid;
+    }
+
+    virtual QString errorString() const {
+        return m_errorString;
+    }
+
+    virtual bool nextUrl(QUrl& url, int& index);
+    virtual void complete(int index, const QString& status);
+
+    /* the same for any worker, as used by the QueueBroker */
+    bool lease(const QString& workerId, QUrl& url, int& index);
+    void complete(const QString& workerId, int index, const QString& status);
+
+    /* Put the leases of a dead worker back. Returns how many. */
+    int requeue(const QString& workerId);
+
+    /* true when there is nothing left to lease or being worked on */
+    bool isFinished();
+
+    static int maxAttempts() {
+        return 3;
+    }
+
+private:
+    static QByteArray readFile(const QString& path);
+    static bool lockCoordinator(const QString& dir, QString& errorString);
+    bool lock();
+    void unlock();
+    QByteArray readState(const QString& name) const;
+    bool writeState(const QString& name, const QByteArray& data);
+    bool appendState(const QString& name, const QByteArray& data);
+    QString leaseFile(const QString& workerId) const;
+
+    QString m_dir;
+    QString m_workerId;
+    int m_lockFd;
+    UrlList m_urls;
+    bool m_valid;
+    QString m_errorString;
+};
+
+/* The client side of a QueueBroker, for workers on other machines:
+ * a line protocol over one TCP connection which stays open while the
+ * worker lives, so the broker can take the leases back when it drops.
+ *
+ *   -> LEASE                    <- URL <index> <encoded url>
+ *                               <- DRAINED
+ *   -> DONE <index> <status>
+ *
+ * Calls block until the broker answers. */
+class RemoteWorkQueue : public WorkQueue {
+public:
+    /* address is "host:port" */
+    RemoteWorkQueue(const QString& address);
+
+    virtual bool isValid() const {
+        return m_valid;
+    }
+
+    virtual QString errorString() const {
+        return m_errorString;
+    }
+
+    virtual bool nextUrl(QUrl& url, int& index);
+    virtual void complete(int index, const QString& status);
+
+private:
+    bool readLine(QByteArray& line);
+
+    QTcpSocket m_socket;
+    bool m_valid;
+    QString m_errorString;
+};
+
+#endif // WORK_QUEUE_H